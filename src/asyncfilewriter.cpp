@@ -0,0 +1,123 @@
+/*
+    VSD prints debugging messages of applications and their
+    sub-processes to console and supports logging of their output.
+    Copyright (C) 2026  Hannah von Reth <vonreth@kde.org>
+
+
+    VSD is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    VSD is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with VSD.  If not, see <http://www.gnu.org/licenses/>.
+    */
+
+
+#include "asyncfilewriter.h"
+
+namespace {
+// the buffer of the output thread holds at most this many times FlushPolicy::size, unless a single write is larger
+constexpr size_t MaxBufferedFlushes = 2;
+}
+
+AsyncFileWriter::AsyncFileWriter(const std::filesystem::path &path, const FlushPolicy &policy)
+    : m_file(CreateFileW(path.wstring().c_str(), GENERIC_WRITE, FILE_SHARE_READ, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr))
+    , m_policy(policy)
+{
+    if (m_file == INVALID_HANDLE_VALUE) {
+        return;
+    }
+    m_front.reserve(m_policy.size);
+    m_thread = std::thread([this] { run(); });
+}
+
+AsyncFileWriter::~AsyncFileWriter()
+{
+    if (m_thread.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stop = true;
+        }
+        m_wakeUp.notify_one();
+        m_thread.join();
+    }
+    if (m_file != INVALID_HANDLE_VALUE) {
+        CloseHandle(m_file);
+    }
+}
+
+bool AsyncFileWriter::isOpen() const
+{
+    return m_file != INVALID_HANDLE_VALUE;
+}
+
+void AsyncFileWriter::write(std::string_view data)
+{
+    if (!isOpen()) {
+        return;
+    }
+    bool full;
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        if (!m_front.empty() && m_front.size() + data.size() > MaxBufferedFlushes * m_policy.size) {
+            // the disk can't keep up, stall the output thread instead of growing the buffer
+            m_wakeUp.notify_one();
+            m_space.wait(lock, [this] { return m_front.empty(); });
+        }
+        m_front += data;
+        full = m_front.size() >= m_policy.size;
+    }
+    if (full) {
+        m_wakeUp.notify_one();
+    }
+}
+
+void AsyncFileWriter::flush()
+{
+    if (!isOpen()) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_front.empty()) {
+            return;
+        }
+        m_flush = true;
+    }
+    m_wakeUp.notify_one();
+}
+
+void AsyncFileWriter::run()
+{
+    std::string back;
+    back.reserve(m_policy.size);
+    bool stop = false;
+    while (!stop) {
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_wakeUp.wait_for(lock, m_policy.interval, [this] { return m_stop || m_flush || m_front.size() >= m_policy.size; });
+            // only the buffers are swapped under the lock, the write happens without it
+            std::swap(m_front, back);
+            m_flush = false;
+            stop = m_stop;
+        }
+        m_space.notify_one();
+        const char *data = back.data();
+        size_t size = back.size();
+        while (size > 0) {
+            DWORD written = 0;
+            if (!WriteFile(m_file, data, static_cast<DWORD>(size < MAXDWORD ? size : MAXDWORD), &written, nullptr)) {
+                break;
+            }
+            data += written;
+            size -= written;
+        }
+        back.clear();
+    }
+}
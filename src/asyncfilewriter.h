@@ -0,0 +1,65 @@
+/*
+    VSD prints debugging messages of applications and their
+    sub-processes to console and supports logging of their output.
+    Copyright (C) 2026  Hannah von Reth <vonreth@kde.org>
+
+
+    VSD is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    VSD is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with VSD.  If not, see <http://www.gnu.org/licenses/>.
+    */
+
+
+#ifndef ASYNCFILEWRITER_H
+#define ASYNCFILEWRITER_H
+
+#include "logwriter.h"
+
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include <windows.h>
+
+// Collects utf-8 text in a buffer that a background thread swaps with its own and writes to disk,
+// so the output thread only waits for the disk once twice FlushPolicy::size is buffered.
+class AsyncFileWriter : public LogWriter
+{
+public:
+    AsyncFileWriter(const std::filesystem::path &path, const FlushPolicy &policy);
+    // writes the remaining data and closes the file
+    ~AsyncFileWriter() override;
+
+    bool isOpen() const override;
+    // blocks while the buffer is full, so the backpressure policy of the dispatcher applies
+    void write(std::string_view data) override;
+    // hands the buffered data to the writer thread without waiting for it to be written
+    void flush() override;
+
+private:
+    void run();
+
+    HANDLE m_file;
+    FlushPolicy m_policy;
+
+    std::mutex m_mutex;
+    std::condition_variable m_wakeUp;
+    // signaled when the writer thread took the buffer
+    std::condition_variable m_space;
+    std::string m_front;
+    bool m_flush = false;
+    bool m_stop = false;
+    std::thread m_thread;
+};
+
+#endif // ASYNCFILEWRITER_H
@@ -0,0 +1,71 @@
+/*
+    VSD prints debugging messages of applications and their
+    sub-processes to console and supports logging of their output.
+    Copyright (C) 2026  Hannah von Reth <vonreth@kde.org>
+
+
+    VSD is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    VSD is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with VSD.  If not, see <http://www.gnu.org/licenses/>.
+    */
+
+
+#include "bufferedfilewriter.h"
+
+BufferedFileWriter::BufferedFileWriter(const std::filesystem::path &path, const FlushPolicy &policy)
+    : m_file(CreateFileW(path.wstring().c_str(), GENERIC_WRITE, FILE_SHARE_READ, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr))
+    , m_policy(policy)
+{
+}
+
+BufferedFileWriter::~BufferedFileWriter()
+{
+    if (m_file != INVALID_HANDLE_VALUE) {
+        flush();
+        CloseHandle(m_file);
+    }
+}
+
+bool BufferedFileWriter::isOpen() const
+{
+    return m_file != INVALID_HANDLE_VALUE;
+}
+
+void BufferedFileWriter::write(std::string_view data)
+{
+    if (!isOpen()) {
+        return;
+    }
+    const auto now = std::chrono::steady_clock::now();
+    if (m_buffer.empty()) {
+        m_bufferedSince = now;
+    }
+    m_buffer += data;
+    if (m_buffer.size() >= BufferSize || m_buffer.size() >= m_policy.size || now - m_bufferedSince >= m_policy.interval) {
+        flush();
+    }
+}
+
+void BufferedFileWriter::flush()
+{
+    const char *data = m_buffer.data();
+    size_t size = m_buffer.size();
+    while (size > 0) {
+        DWORD written = 0;
+        if (!WriteFile(m_file, data, static_cast<DWORD>(size < MAXDWORD ? size : MAXDWORD), &written, nullptr)) {
+            break;
+        }
+        data += written;
+        size -= written;
+    }
+    m_buffer.clear();
+}
@@ -0,0 +1,55 @@
+/*
+    VSD prints debugging messages of applications and their
+    sub-processes to console and supports logging of their output.
+    Copyright (C) 2026  Hannah von Reth <vonreth@kde.org>
+
+
+    VSD is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    VSD is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with VSD.  If not, see <http://www.gnu.org/licenses/>.
+    */
+
+
+#ifndef BUFFEREDFILEWRITER_H
+#define BUFFEREDFILEWRITER_H
+
+#include "logwriter.h"
+
+#include <chrono>
+#include <string>
+
+#include <windows.h>
+
+// Writes on the calling thread through a small buffer, for the many short lived logs of the processes.
+// It needs neither a thread nor large buffers, the buffer is written once it is full or older than FlushPolicy::interval.
+class BufferedFileWriter : public LogWriter
+{
+public:
+    BufferedFileWriter(const std::filesystem::path &path, const FlushPolicy &policy);
+    // writes the remaining data and closes the file
+    ~BufferedFileWriter() override;
+
+    bool isOpen() const override;
+    void write(std::string_view data) override;
+    void flush() override;
+
+private:
+    static constexpr size_t BufferSize = 64 * 1024;
+
+    HANDLE m_file;
+    FlushPolicy m_policy;
+    std::string m_buffer;
+    // when the oldest data in the buffer was written
+    std::chrono::steady_clock::time_point m_bufferedSince;
+};
+
+#endif // BUFFEREDFILEWRITER_H
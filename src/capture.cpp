@@ -0,0 +1,222 @@
+/*
+    VSD prints debugging messages of applications and their
+    sub-processes to console and supports logging of their output.
+    Copyright (C) 2026  Hannah von Reth <vonreth@kde.org>
+
+
+    VSD is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    VSD is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with VSD.  If not, see <http://www.gnu.org/licenses/>.
+    */
+
+
+#include "capture.h"
+
+#include "libvsd/utils.h"
+#include "libvsd/vsdchildprocess.h"
+
+#include <windows.h>
+
+namespace Capture {
+
+Writer::Writer(const std::filesystem::path &path, const LogWriter::FlushPolicy &policy, std::string_view program, std::string_view arguments)
+    : m_out(path, policy)
+    , m_last(std::chrono::high_resolution_clock::now())
+{
+    m_buffer.assign(Magic, sizeof(Magic));
+    m_buffer += static_cast<char>(Version);
+    appendString(program);
+    appendString(arguments);
+    m_out.write(m_buffer);
+}
+
+bool Writer::isOpen() const
+{
+    return m_out.isOpen();
+}
+
+void Writer::write(const libvsd::VSDEvent *events, size_t count)
+{
+    m_buffer.clear();
+    for (const libvsd::VSDEvent *event = events; event != events + count; ++event) {
+        m_buffer += static_cast<char>(event->type);
+        // the producers take their timestamps independently, so they might be slightly out of order
+        const auto delta = std::chrono::duration_cast<std::chrono::microseconds>(event->timestamp - m_last);
+        if (delta.count() > 0) {
+            appendVarint(delta.count());
+            m_last += delta;
+        } else {
+            appendVarint(0);
+        }
+        appendVarint(event->pid);
+        appendVarint(event->tid);
+        switch (event->type) {
+        case Type::Stdout:
+        case Type::Stderr:
+        case Type::Debug:
+        case Type::DllLoad:
+        case Type::DllUnload:
+            appendString(event->data);
+            break;
+        case Type::ProcessStarted:
+            appendString(event->process->utf8Name());
+            appendString(Utils::wideCharToMultiByte(event->process->path().wstring()));
+            appendString(Utils::wideCharToMultiByte(event->process->arguments()));
+            break;
+        case Type::ProcessStopped:
+            appendVarint(event->process->exitCode());
+            appendVarint(std::chrono::duration_cast<std::chrono::microseconds>(event->process->time()).count());
+            appendString(Utils::wideCharToMultiByte(event->process->error()));
+            break;
+        }
+    }
+    m_out.write(m_buffer);
+}
+
+void Writer::appendVarint(uint64_t value)
+{
+    while (value >= 0x80) {
+        m_buffer += static_cast<char>(value | 0x80);
+        value >>= 7;
+    }
+    m_buffer += static_cast<char>(value);
+}
+
+void Writer::appendString(std::string_view data)
+{
+    appendVarint(data.size());
+    m_buffer += data;
+}
+
+Reader::Reader(const std::filesystem::path &path)
+{
+    // captures of long sessions can be larger than the memory, so the file is mapped instead of read
+    HANDLE file = CreateFileW(path.wstring().c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        return;
+    }
+    LARGE_INTEGER fileSize;
+    // an empty file can't be mapped
+    HANDLE mapping = GetFileSizeEx(file, &fileSize) && fileSize.QuadPart > 0 ? CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr) : nullptr;
+    CloseHandle(file);
+    if (!mapping) {
+        return;
+    }
+    // the view keeps the mapping alive
+    const auto view = static_cast<const char *>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+    CloseHandle(mapping);
+    if (!view) {
+        return;
+    }
+    m_data = std::string_view(view, static_cast<size_t>(fileSize.QuadPart));
+    if (m_data.size() < sizeof(Magic) + 1 || m_data.compare(0, sizeof(Magic), Magic, sizeof(Magic)) != 0
+        || static_cast<uint8_t>(m_data[sizeof(Magic)]) != Version) {
+        return;
+    }
+    m_pos = sizeof(Magic) + 1;
+    std::string_view program;
+    std::string_view arguments;
+    m_valid = readString(program) && readString(arguments);
+    m_program = program;
+    m_arguments = arguments;
+}
+
+Reader::~Reader()
+{
+    if (m_data.data()) {
+        UnmapViewOfFile(m_data.data());
+    }
+}
+
+bool Reader::isValid() const
+{
+    return m_valid;
+}
+
+const std::string &Reader::program() const
+{
+    return m_program;
+}
+
+const std::string &Reader::arguments() const
+{
+    return m_arguments;
+}
+
+bool Reader::next(Record &record)
+{
+    if (!m_valid || m_pos >= m_data.size()) {
+        return false;
+    }
+    const auto type = static_cast<uint8_t>(m_data[m_pos++]);
+    if (type > static_cast<uint8_t>(Type::ProcessStopped)) {
+        m_valid = false;
+        return false;
+    }
+    record = {};
+    record.type = static_cast<Type>(type);
+    uint64_t delta, pid, tid;
+    if (!readVarint(delta) || !readVarint(pid) || !readVarint(tid)) {
+        return false;
+    }
+    m_time += std::chrono::microseconds(delta);
+    record.time = m_time;
+    record.pid = static_cast<unsigned long>(pid);
+    record.tid = static_cast<unsigned long>(tid);
+    switch (record.type) {
+    case Type::Stdout:
+    case Type::Stderr:
+    case Type::Debug:
+    case Type::DllLoad:
+    case Type::DllUnload:
+        return readString(record.data);
+    case Type::ProcessStarted:
+        return readString(record.data) && readString(record.path) && readString(record.arguments);
+    case Type::ProcessStopped: {
+        uint64_t exitCode, runTime;
+        if (!readVarint(exitCode) || !readVarint(runTime)) {
+            return false;
+        }
+        record.exitCode = static_cast<uint32_t>(exitCode);
+        record.runTime = std::chrono::microseconds(runTime);
+        return readString(record.data);
+    }
+    }
+    return false;
+}
+
+bool Reader::readVarint(uint64_t &value)
+{
+    value = 0;
+    for (int shift = 0; shift < 64 && m_pos < m_data.size(); shift += 7) {
+        const auto byte = static_cast<uint8_t>(m_data[m_pos++]);
+        value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) {
+            return true;
+        }
+    }
+    m_valid = false;
+    return false;
+}
+
+bool Reader::readString(std::string_view &data)
+{
+    uint64_t size;
+    if (!readVarint(size) || size > m_data.size() - m_pos) {
+        m_valid = false;
+        return false;
+    }
+    data = std::string_view(m_data.data() + m_pos, static_cast<size_t>(size));
+    m_pos += static_cast<size_t>(size);
+    return true;
+}
+}
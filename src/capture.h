@@ -0,0 +1,111 @@
+/*
+    VSD prints debugging messages of applications and their
+    sub-processes to console and supports logging of their output.
+    Copyright (C) 2026  Hannah von Reth <vonreth@kde.org>
+
+
+    VSD is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    VSD is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with VSD.  If not, see <http://www.gnu.org/licenses/>.
+    */
+
+
+#ifndef CAPTURE_H
+#define CAPTURE_H
+
+#include "asyncfilewriter.h"
+
+#include "libvsd/vsdprocess.h"
+
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <string_view>
+
+// The .vsdc capture format, all integers are unsigned LEB128 varints and all strings are utf-8 with a varint length:
+//   header: "VSDC", format version byte, program, arguments
+//   record: event type byte, timestamp delta to the previous record in microseconds, pid, tid,
+//           followed by the data of the type:
+//           Stdout, Stderr, Debug, DllLoad, DllUnload: payload
+//           ProcessStarted: name, path, arguments
+//           ProcessStopped: exit code, run time in microseconds, error
+namespace Capture {
+constexpr char Magic[] = { 'V', 'S', 'D', 'C' };
+constexpr uint8_t Version = 1;
+
+using Type = libvsd::VSDEvent::Type;
+
+// Writes the events as they are delivered, the only work done on the output thread is the encoding
+class Writer
+{
+public:
+    Writer(const std::filesystem::path &path, const LogWriter::FlushPolicy &policy, std::string_view program, std::string_view arguments);
+
+    bool isOpen() const;
+    void write(const libvsd::VSDEvent *events, size_t count);
+
+private:
+    void appendVarint(uint64_t value);
+    void appendString(std::string_view data);
+
+    AsyncFileWriter m_out;
+    std::string m_buffer;
+    std::chrono::high_resolution_clock::time_point m_last;
+};
+
+struct Record
+{
+    Type type = Type::Stdout;
+    // time since the capture started
+    std::chrono::microseconds time { 0 };
+    unsigned long pid = 0;
+    unsigned long tid = 0;
+    // the payload, or the name of the process for ProcessStarted, the error for ProcessStopped
+    std::string_view data;
+    std::string_view path;
+    std::string_view arguments;
+    uint32_t exitCode = 0;
+    std::chrono::microseconds runTime { 0 };
+};
+
+// Reads a mapped capture file, a truncated capture is read up to the last complete record
+class Reader
+{
+public:
+    Reader(const std::filesystem::path &path);
+    ~Reader();
+    Reader(const Reader &) = delete;
+    Reader &operator=(const Reader &) = delete;
+
+    bool isValid() const;
+    const std::string &program() const;
+    const std::string &arguments() const;
+
+    // the views of record stay valid as long as the reader exists
+    bool next(Record &record);
+
+private:
+    bool readVarint(uint64_t &value);
+    bool readString(std::string_view &data);
+
+    // the view of the whole file
+    std::string_view m_data;
+    size_t m_pos = 0;
+    bool m_valid = false;
+    std::string m_program;
+    std::string m_arguments;
+    std::chrono::microseconds m_time { 0 };
+};
+}
+
+#endif // CAPTURE_H
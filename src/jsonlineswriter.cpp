@@ -0,0 +1,186 @@
+/*
+    VSD prints debugging messages of applications and their
+    sub-processes to console and supports logging of their output.
+    Copyright (C) 2026  Hannah von Reth <vonreth@kde.org>
+
+
+    VSD is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    VSD is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with VSD.  If not, see <http://www.gnu.org/licenses/>.
+    */
+
+
+#include "jsonlineswriter.h"
+
+#include "libvsd/utils.h"
+#include "libvsd/vsdchildprocess.h"
+
+#include <charconv>
+
+namespace {
+using Type = libvsd::VSDEvent::Type;
+
+// the civil date of the days since 1970-01-01
+void civilFromDays(int64_t days, int64_t &year, unsigned &month, unsigned &day)
+{
+    days += 719468;
+    const int64_t era = (days >= 0 ? days : days - 146096) / 146097;
+    const unsigned dayOfEra = static_cast<unsigned>(days - era * 146097);
+    const unsigned yearOfEra = (dayOfEra - dayOfEra / 1460 + dayOfEra / 36524 - dayOfEra / 146096) / 365;
+    const unsigned dayOfYear = dayOfEra - (365 * yearOfEra + yearOfEra / 4 - yearOfEra / 100);
+    const unsigned mp = (5 * dayOfYear + 2) / 153;
+    day = dayOfYear - (153 * mp + 2) / 5 + 1;
+    month = mp < 10 ? mp + 3 : mp - 9;
+    year = static_cast<int64_t>(yearOfEra) + era * 400 + (month <= 2);
+}
+
+void appendDigits(std::string &out, uint64_t value, int width)
+{
+    char buffer[20];
+    for (int i = width - 1; i >= 0; --i) {
+        buffer[i] = static_cast<char>('0' + value % 10);
+        value /= 10;
+    }
+    out.append(buffer, width);
+}
+}
+
+JsonLinesWriter::JsonLinesWriter(const std::filesystem::path &path, LogWriter::Type type, const LogWriter::FlushPolicy &policy)
+    : m_out(LogWriter::create(type, path, policy))
+    , m_flushOnError(policy.onError)
+    , m_clockOffset(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::system_clock::now().time_since_epoch())
+                    - std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now().time_since_epoch()))
+{
+}
+
+bool JsonLinesWriter::isOpen() const
+{
+    return m_out->isOpen();
+}
+
+void JsonLinesWriter::write(const libvsd::VSDEvent *events, size_t count)
+{
+    m_buffer.clear();
+    bool error = false;
+    for (const libvsd::VSDEvent *event = events; event != events + count; ++event) {
+        m_buffer += '{';
+        appendTime(event->timestamp);
+        std::string_view text = event->data;
+        switch (event->type) {
+        case Type::Stdout:
+        case Type::Stderr:
+            appendString("type", "output");
+            appendString("channel", event->type == Type::Stdout ? "stdout" : "stderr");
+            error |= event->type == Type::Stderr;
+            // the pipes are not checked for valid utf-8 on the way
+            if (!Utils::isValidUtf8(text)) {
+                Utils::ansiToUtf8(text, m_scratch);
+                text = m_scratch;
+            }
+            appendString("text", text);
+            break;
+        case Type::Debug:
+            appendString("type", "output");
+            appendString("channel", "debug");
+            appendNumber("pid", event->pid);
+            appendNumber("tid", event->tid);
+            appendString("process", event->process->utf8Name());
+            appendString("text", text);
+            break;
+        case Type::DllLoad:
+        case Type::DllUnload:
+            appendString("type", event->type == Type::DllLoad ? "dllLoad" : "dllUnload");
+            appendNumber("pid", event->pid);
+            appendString("process", event->process->utf8Name());
+            appendString("text", text);
+            break;
+        case Type::ProcessStarted:
+            appendString("type", "processStarted");
+            appendNumber("pid", event->pid);
+            appendString("process", event->process->utf8Name());
+            appendString("path", Utils::wideCharToMultiByte(event->process->path().wstring()));
+            appendString("arguments", Utils::wideCharToMultiByte(event->process->arguments()));
+            break;
+        case Type::ProcessStopped:
+            appendString("type", "processStopped");
+            appendNumber("pid", event->pid);
+            appendString("process", event->process->utf8Name());
+            appendString("path", Utils::wideCharToMultiByte(event->process->path().wstring()));
+            appendNumber("exitCode", event->process->exitCode());
+            appendNumber("runTimeMs", std::chrono::duration_cast<std::chrono::milliseconds>(event->process->time()).count());
+            if (!event->process->error().empty()) {
+                appendString("error", Utils::wideCharToMultiByte(event->process->error()));
+            }
+            break;
+        }
+        m_buffer += "}\n";
+    }
+    m_out->write(m_buffer);
+    if (error && m_flushOnError) {
+        m_out->flush();
+    }
+}
+
+void JsonLinesWriter::appendKey(std::string_view key)
+{
+    if (m_buffer.back() != '{') {
+        m_buffer += ',';
+    }
+    m_buffer += '"';
+    m_buffer += key;
+    m_buffer += "\":";
+}
+
+void JsonLinesWriter::appendString(std::string_view key, std::string_view value)
+{
+    appendKey(key);
+    m_buffer += '"';
+    Utils::appendEscapedJson(value, m_buffer);
+    m_buffer += '"';
+}
+
+void JsonLinesWriter::appendNumber(std::string_view key, uint64_t value)
+{
+    appendKey(key);
+    char buffer[20];
+    const auto result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+    m_buffer.append(buffer, result.ptr);
+}
+
+void JsonLinesWriter::appendTime(std::chrono::high_resolution_clock::time_point timestamp)
+{
+    // 2026-01-01T12:00:00.000000Z
+    const int64_t time = (std::chrono::duration_cast<std::chrono::microseconds>(timestamp.time_since_epoch()) + m_clockOffset).count();
+    const int64_t microsecondsPerDay = 86400000000;
+    const int64_t days = time / microsecondsPerDay;
+    const uint64_t timeOfDay = static_cast<uint64_t>(time % microsecondsPerDay);
+    int64_t year;
+    unsigned month, day;
+    civilFromDays(days, year, month, day);
+
+    appendKey("time");
+    m_buffer += '"';
+    appendDigits(m_buffer, static_cast<uint64_t>(year), 4);
+    m_buffer += '-';
+    appendDigits(m_buffer, month, 2);
+    m_buffer += '-';
+    appendDigits(m_buffer, day, 2);
+    m_buffer += 'T';
+    appendDigits(m_buffer, timeOfDay / 3600000000, 2);
+    m_buffer += ':';
+    appendDigits(m_buffer, timeOfDay / 60000000 % 60, 2);
+    m_buffer += ':';
+    appendDigits(m_buffer, timeOfDay / 1000000 % 60, 2);
+    m_buffer += '.';
+    appendDigits(m_buffer, timeOfDay % 1000000, 6);
+    m_buffer += "Z\"";
+}
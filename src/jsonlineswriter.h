@@ -0,0 +1,59 @@
+/*
+    VSD prints debugging messages of applications and their
+    sub-processes to console and supports logging of their output.
+    Copyright (C) 2026  Hannah von Reth <vonreth@kde.org>
+
+
+    VSD is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    VSD is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with VSD.  If not, see <http://www.gnu.org/licenses/>.
+    */
+
+
+#ifndef JSONLINESWRITER_H
+#define JSONLINESWRITER_H
+
+#include "logwriter.h"
+
+#include "libvsd/vsdprocess.h"
+
+#include <chrono>
+#include <memory>
+#include <string>
+#include <string_view>
+
+// Writes one json object per event, for example
+// {"time":"2026-01-01T12:00:00.000000Z","type":"output","channel":"debug","pid":42,"tid":7,"process":"kate","text":"..."}
+// The objects are encoded directly into a reused buffer, no json document is built.
+class JsonLinesWriter
+{
+public:
+    JsonLinesWriter(const std::filesystem::path &path, LogWriter::Type type, const LogWriter::FlushPolicy &policy);
+
+    bool isOpen() const;
+    void write(const libvsd::VSDEvent *events, size_t count);
+
+private:
+    void appendKey(std::string_view key);
+    void appendString(std::string_view key, std::string_view value);
+    void appendNumber(std::string_view key, uint64_t value);
+    void appendTime(std::chrono::high_resolution_clock::time_point timestamp);
+
+    std::unique_ptr<LogWriter> m_out;
+    bool m_flushOnError;
+    std::string m_buffer;
+    std::string m_scratch;
+    // converts the timestamps of the events to the system time
+    std::chrono::microseconds m_clockOffset;
+};
+
+#endif // JSONLINESWRITER_H
@@ -28,6 +28,94 @@
 #include <sstream>
 #include <psapi.h>
 
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#define VSD_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace {
+static_assert(sizeof(wchar_t) == 2, "the transcoders expect utf-16");
+
+constexpr uint32_t InvalidCodePoint = 0xFFFFFFFF;
+constexpr wchar_t ReplacementCharacter = 0xFFFD;
+
+// the number of leading ascii bytes
+size_t asciiPrefix(const char *data, size_t size)
+{
+    size_t i = 0;
+#ifdef VSD_SSE2
+    for (; i + 16 <= size; i += 16) {
+        const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i));
+        if (_mm_movemask_epi8(chunk)) {
+            break;
+        }
+    }
+#endif
+    while (i < size && static_cast<unsigned char>(data[i]) < 0x80) {
+        ++i;
+    }
+    return i;
+}
+
+// decodes the code point at pos and advances pos, an invalid sequence only skips its first byte
+uint32_t decodeUtf8(const unsigned char *data, size_t size, size_t &pos)
+{
+    const unsigned char c = data[pos];
+    if (c < 0x80) {
+        ++pos;
+        return c;
+    }
+    size_t length;
+    uint32_t codePoint;
+    uint32_t min;
+    if ((c & 0xE0) == 0xC0) {
+        length = 2;
+        codePoint = c & 0x1F;
+        min = 0x80;
+    } else if ((c & 0xF0) == 0xE0) {
+        length = 3;
+        codePoint = c & 0x0F;
+        min = 0x800;
+    } else if ((c & 0xF8) == 0xF0) {
+        length = 4;
+        codePoint = c & 0x07;
+        min = 0x10000;
+    } else {
+        ++pos;
+        return InvalidCodePoint;
+    }
+    if (pos + length > size) {
+        ++pos;
+        return InvalidCodePoint;
+    }
+    for (size_t i = 1; i < length; ++i) {
+        const unsigned char next = data[pos + i];
+        if ((next & 0xC0) != 0x80) {
+            ++pos;
+            return InvalidCodePoint;
+        }
+        codePoint = (codePoint << 6) | (next & 0x3F);
+    }
+    // reject overlong encodings and surrogates
+    if (codePoint < min || codePoint > 0x10FFFF || (codePoint >= 0xD800 && codePoint <= 0xDFFF)) {
+        ++pos;
+        return InvalidCodePoint;
+    }
+    pos += length;
+    return codePoint;
+}
+
+inline bool isHtmlSpecial(char c)
+{
+    return c == '&' || c == '<' || c == '>' || c == '\r' || c == '\n';
+}
+
+inline bool isJsonSpecial(char c)
+{
+    return c == '"' || c == '\\' || static_cast<unsigned char>(c) < 0x20;
+}
+}
+
 namespace Utils {
 
 std::wstring getFinalPathNameByHandle(const HANDLE handle)
@@ -47,14 +135,264 @@ std::wstring getFinalPathNameByHandle(const HANDLE handle)
     return L"getFinalPathNameByHandle Failed! " + formatError(GetLastError());
 }
 
-std::wstring multiByteToWideChar(const std::string &data)
+std::wstring multiByteToWideChar(std::string_view data)
 {
-    const size_t outSize = MultiByteToWideChar(CP_UTF8, MB_USEGLYPHCHARS, data.data(), static_cast<int>(data.size()), nullptr, 0);
-    auto out = std::wstring(outSize, 0);
-    MultiByteToWideChar(CP_UTF8, MB_USEGLYPHCHARS, data.data(), static_cast<int>(data.size()), out.data(), static_cast<int>(outSize));
+    std::wstring out;
+    utf8ToUtf16(data, out);
     return out;
 }
 
+std::string wideCharToMultiByte(std::wstring_view data)
+{
+    std::string out;
+    utf16ToUtf8(data, out);
+    return out;
+}
+
+void utf8ToUtf16(std::string_view data, std::wstring &out)
+{
+    // a utf-16 string never has more code units than the utf-8 string has bytes
+    out.resize(data.size());
+    const auto src = reinterpret_cast<const unsigned char *>(data.data());
+    const size_t size = data.size();
+    wchar_t *dst = out.data();
+    size_t pos = 0;
+    while (pos < size) {
+#ifdef VSD_SSE2
+        // widen blocks of ascii
+        const __m128i zero = _mm_setzero_si128();
+        for (; pos + 16 <= size; pos += 16, dst += 16) {
+            const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + pos));
+            if (_mm_movemask_epi8(chunk)) {
+                break;
+            }
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(dst), _mm_unpacklo_epi8(chunk, zero));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + 8), _mm_unpackhi_epi8(chunk, zero));
+        }
+        if (pos == size) {
+            break;
+        }
+#endif
+        const uint32_t codePoint = decodeUtf8(src, size, pos);
+        if (codePoint == InvalidCodePoint) {
+            *dst++ = ReplacementCharacter;
+        } else if (codePoint >= 0x10000) {
+            *dst++ = static_cast<wchar_t>(0xD800 + ((codePoint - 0x10000) >> 10));
+            *dst++ = static_cast<wchar_t>(0xDC00 + ((codePoint - 0x10000) & 0x3FF));
+        } else {
+            *dst++ = static_cast<wchar_t>(codePoint);
+        }
+    }
+    out.resize(dst - out.data());
+}
+
+void utf16ToUtf8(std::wstring_view data, std::string &out)
+{
+    // at most 3 bytes per code unit, a surrogate pair needs 4 bytes for 2 units
+    out.resize(data.size() * 3);
+    const wchar_t *src = data.data();
+    const size_t size = data.size();
+    char *dst = out.data();
+    size_t pos = 0;
+    while (pos < size) {
+#ifdef VSD_SSE2
+        // narrow blocks of ascii
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i nonAscii = _mm_set1_epi16(static_cast<short>(0xFF80));
+        for (; pos + 8 <= size; pos += 8, dst += 8) {
+            const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + pos));
+            if (_mm_movemask_epi8(_mm_cmpeq_epi16(_mm_and_si128(chunk, nonAscii), zero)) != 0xFFFF) {
+                break;
+            }
+            _mm_storel_epi64(reinterpret_cast<__m128i *>(dst), _mm_packus_epi16(chunk, chunk));
+        }
+        if (pos == size) {
+            break;
+        }
+#endif
+        uint32_t codePoint = static_cast<uint16_t>(src[pos++]);
+        if (codePoint >= 0xD800 && codePoint <= 0xDFFF) {
+            const uint32_t low = pos < size ? static_cast<uint16_t>(src[pos]) : 0;
+            if (codePoint <= 0xDBFF && low >= 0xDC00 && low <= 0xDFFF) {
+                codePoint = 0x10000 + ((codePoint - 0xD800) << 10) + (low - 0xDC00);
+                ++pos;
+            } else {
+                codePoint = ReplacementCharacter;
+            }
+        }
+        if (codePoint < 0x80) {
+            *dst++ = static_cast<char>(codePoint);
+        } else if (codePoint < 0x800) {
+            *dst++ = static_cast<char>(0xC0 | (codePoint >> 6));
+            *dst++ = static_cast<char>(0x80 | (codePoint & 0x3F));
+        } else if (codePoint < 0x10000) {
+            *dst++ = static_cast<char>(0xE0 | (codePoint >> 12));
+            *dst++ = static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+            *dst++ = static_cast<char>(0x80 | (codePoint & 0x3F));
+        } else {
+            *dst++ = static_cast<char>(0xF0 | (codePoint >> 18));
+            *dst++ = static_cast<char>(0x80 | ((codePoint >> 12) & 0x3F));
+            *dst++ = static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+            *dst++ = static_cast<char>(0x80 | (codePoint & 0x3F));
+        }
+    }
+    out.resize(dst - out.data());
+}
+
+void ansiToUtf8(std::string_view data, std::string &out)
+{
+    if (isAscii(data)) {
+        out.assign(data);
+        return;
+    }
+    // every byte results in at most one utf-16 code unit
+    std::wstring wide(data.size(), 0);
+    wide.resize(MultiByteToWideChar(CP_ACP, 0, data.data(), static_cast<int>(data.size()), wide.data(), static_cast<int>(wide.size())));
+    utf16ToUtf8(wide, out);
+}
+
+bool isAscii(std::string_view data)
+{
+    return asciiPrefix(data.data(), data.size()) == data.size();
+}
+
+void appendEscapedHtml(std::string_view data, std::string &out)
+{
+    const char *src = data.data();
+    const size_t size = data.size();
+    // start of the run of bytes that don't need to be escaped
+    size_t run = 0;
+    size_t pos = 0;
+    while (pos < size) {
+#ifdef VSD_SSE2
+        // skip blocks without special characters
+        const __m128i amp = _mm_set1_epi8('&');
+        const __m128i lt = _mm_set1_epi8('<');
+        const __m128i gt = _mm_set1_epi8('>');
+        const __m128i cr = _mm_set1_epi8('\r');
+        const __m128i lf = _mm_set1_epi8('\n');
+        for (; pos + 16 <= size; pos += 16) {
+            const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + pos));
+            const __m128i special = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(chunk, amp), _mm_cmpeq_epi8(chunk, lt)),
+                _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(chunk, gt), _mm_cmpeq_epi8(chunk, cr)), _mm_cmpeq_epi8(chunk, lf)));
+            if (_mm_movemask_epi8(special)) {
+                break;
+            }
+        }
+        // handle the block containing the special character byte by byte
+        const size_t end = pos + 16 < size ? pos + 16 : size;
+#else
+        const size_t end = size;
+#endif
+        for (; pos < end; ++pos) {
+            const char c = src[pos];
+            if (!isHtmlSpecial(c)) {
+                continue;
+            }
+            out.append(src + run, pos - run);
+            switch (c) {
+            case '&':
+                out.append("&amp;");
+                break;
+            case '<':
+                out.append("&lt;");
+                break;
+            case '>':
+                out.append("&gt;");
+                break;
+            case '\r':
+                // \r\n is a single line break
+                if (pos + 1 < size && src[pos + 1] == '\n') {
+                    ++pos;
+                }
+                out.append("<br>");
+                break;
+            case '\n':
+                out.append("<br>");
+                break;
+            }
+            run = pos + 1;
+        }
+    }
+    out.append(src + run, size - run);
+}
+
+void appendEscapedJson(std::string_view data, std::string &out)
+{
+    static const char hex[] = "0123456789abcdef";
+    const char *src = data.data();
+    const size_t size = data.size();
+    // start of the run of bytes that don't need to be escaped
+    size_t run = 0;
+    size_t pos = 0;
+    while (pos < size) {
+#ifdef VSD_SSE2
+        // skip blocks without quotes, backslashes and control characters
+        const __m128i quote = _mm_set1_epi8('"');
+        const __m128i backslash = _mm_set1_epi8('\\');
+        const __m128i control = _mm_set1_epi8(0x1f);
+        for (; pos + 16 <= size; pos += 16) {
+            const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + pos));
+            // unsigned chunk <= 0x1f
+            const __m128i isControl = _mm_cmpeq_epi8(_mm_max_epu8(chunk, control), control);
+            const __m128i special = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(chunk, quote), _mm_cmpeq_epi8(chunk, backslash)), isControl);
+            if (_mm_movemask_epi8(special)) {
+                break;
+            }
+        }
+        // handle the block containing the special character byte by byte
+        const size_t end = pos + 16 < size ? pos + 16 : size;
+#else
+        const size_t end = size;
+#endif
+        for (; pos < end; ++pos) {
+            const char c = src[pos];
+            if (!isJsonSpecial(c)) {
+                continue;
+            }
+            out.append(src + run, pos - run);
+            switch (c) {
+            case '"':
+                out.append("\\\"");
+                break;
+            case '\\':
+                out.append("\\\\");
+                break;
+            case '\n':
+                out.append("\\n");
+                break;
+            case '\r':
+                out.append("\\r");
+                break;
+            case '\t':
+                out.append("\\t");
+                break;
+            default:
+                out.append("\\u00");
+                out += hex[(c >> 4) & 0xf];
+                out += hex[c & 0xf];
+            }
+            run = pos + 1;
+        }
+    }
+    out.append(src + run, size - run);
+}
+
+bool isValidUtf8(std::string_view data)
+{
+    const auto src = reinterpret_cast<const unsigned char *>(data.data());
+    size_t pos = 0;
+    while (true) {
+        pos += asciiPrefix(data.data() + pos, data.size() - pos);
+        if (pos == data.size()) {
+            return true;
+        }
+        if (decodeUtf8(src, data.size(), pos) == InvalidCodePoint) {
+            return false;
+        }
+    }
+}
+
 std::wstring formatError(unsigned long errorCode)
 {
     std::wstringstream out;
@@ -22,6 +22,7 @@
 #define UTILS_H
 
 #include <string>
+#include <string_view>
 #include <algorithm>
 #include <windows.h>
 
@@ -39,7 +40,28 @@ inline void trimNull(std::wstring &s)
 
 std::wstring getFinalPathNameByHandle(const HANDLE handle);
 
-std::wstring multiByteToWideChar(const std::string &data);
+LIBVSD_EXPORT std::wstring multiByteToWideChar(std::string_view data);
+
+LIBVSD_EXPORT std::string wideCharToMultiByte(std::wstring_view data);
+
+// The transcoders write into the caller provided buffer in a single pass, reusing its capacity.
+// Invalid sequences are replaced by U+FFFD.
+LIBVSD_EXPORT void utf8ToUtf16(std::string_view data, std::wstring &out);
+
+LIBVSD_EXPORT void utf16ToUtf8(std::wstring_view data, std::string &out);
+
+// converts from the ansi code page, OutputDebugStringA does not need to be utf-8
+LIBVSD_EXPORT void ansiToUtf8(std::string_view data, std::string &out);
+
+LIBVSD_EXPORT bool isAscii(std::string_view data);
+
+LIBVSD_EXPORT bool isValidUtf8(std::string_view data);
+
+// appends data to out, escapes &, < and > and replaces line breaks by <br>
+LIBVSD_EXPORT void appendEscapedHtml(std::string_view data, std::string &out);
+
+// appends data to out, escapes it for a json string, data must be valid utf-8
+LIBVSD_EXPORT void appendEscapedJson(std::string_view data, std::string &out);
 
 std::wstring formatError(unsigned long errorCode);
 
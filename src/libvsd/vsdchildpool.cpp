@@ -0,0 +1,54 @@
+/*
+    VSD prints debugging messages of applications and their
+    sub-processes to console and supports logging of their output.
+    Copyright (C) 2026  Hannah von Reth <vonreth@kde.org>
+
+
+    VSD is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    VSD is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with VSD.  If not, see <http://www.gnu.org/licenses/>.
+    */
+
+
+#include "vsdchildpool.h"
+#include "vsdchildprocess.h"
+
+using namespace libvsd;
+
+VSDChildPool::VSDChildPool() = default;
+
+VSDChildPool::~VSDChildPool() = default;
+
+VSDChildProcess *VSDChildPool::acquire(VSDClient *client, unsigned long id, HANDLE fileHandle)
+{
+    VSDChildProcess *child = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_free.empty()) {
+            child = m_free.back();
+            m_free.pop_back();
+        }
+    }
+    if (child) {
+        child->reset(client, id, fileHandle);
+        return child;
+    }
+    m_processes.push_back(std::make_unique<VSDChildProcess>(client, id, fileHandle));
+    return m_processes.back().get();
+}
+
+void VSDChildPool::release(VSDChildProcess *child)
+{
+    child->close();
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_free.push_back(child);
+}
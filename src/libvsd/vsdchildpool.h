@@ -0,0 +1,56 @@
+/*
+    VSD prints debugging messages of applications and their
+    sub-processes to console and supports logging of their output.
+    Copyright (C) 2026  Hannah von Reth <vonreth@kde.org>
+
+
+    VSD is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    VSD is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with VSD.  If not, see <http://www.gnu.org/licenses/>.
+    */
+
+
+#ifndef VSDCHILDPOOL_H
+#define VSDCHILDPOOL_H
+
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <windows.h>
+
+namespace libvsd {
+class VSDClient;
+class VSDChildProcess;
+
+// Owns the VSDChildProcess objects and recycles them, so the buffers of a stopped process are reused by the next one.
+// The debugger thread acquires the processes, the dispatcher hands them back once their stop was delivered.
+class VSDChildPool
+{
+public:
+    VSDChildPool();
+    ~VSDChildPool();
+
+    VSDChildProcess *acquire(VSDClient *client, unsigned long id, HANDLE fileHandle);
+    // thread safe, closes the handles of the process
+    void release(VSDChildProcess *child);
+
+private:
+    // running or not
+    std::vector<std::unique_ptr<VSDChildProcess>> m_processes;
+    std::mutex m_mutex;
+    std::vector<VSDChildProcess *> m_free;
+};
+
+}
+
+#endif // VSDCHILDPOOL_H
@@ -27,6 +27,8 @@
 #include <windows.h>
 #include <winternl.h>
 
+#include <algorithm>
+#include <cstring>
 #include <iostream>
 #include <string>
 #include <sstream>
@@ -39,7 +41,7 @@ std::wstring getProcessArgs(HANDLE processHandle, VSDClient *client)
 {
     const auto logError = [client](bool b, const std::wstring &call) {
         if (!b) {
-            client->writeErr(L"getProcessArgs: '" + call + L"' failed! " + Utils::formatError(GetLastError()));
+            client->writeErr(Utils::wideCharToMultiByte(L"getProcessArgs: '" + call + L"' failed! " + Utils::formatError(GetLastError())));
         }
         return b;
     };
@@ -68,39 +70,143 @@ std::wstring getProcessArgs(HANDLE processHandle, VSDClient *client)
     }
     return {};
 }
+
+template <typename T>
+bool readHeader(const char *data, size_t size, size_t offset, T &out)
+{
+    if (offset > size || size - offset < sizeof(T)) {
+        return false;
+    }
+    memcpy(&out, data + offset, sizeof(T));
+    return true;
 }
-Module::Module(const LOAD_DLL_DEBUG_INFO &info, VSDChildProcess *parent)
-    : m_name(Utils::getFinalPathNameByHandle(info.hFile))
-    , m_parent(parent)
-    , m_module(static_cast<HMODULE>(info.lpBaseOfDll))
+
+std::optional<ModuleImage> parseImage(const char *data, size_t size)
 {
+    IMAGE_DOS_HEADER dosHeader;
+    if (!readHeader(data, size, 0, dosHeader) || dosHeader.e_magic != IMAGE_DOS_SIGNATURE || dosHeader.e_lfanew < 0) {
+        return {};
+    }
+    size_t offset = static_cast<size_t>(dosHeader.e_lfanew);
+    DWORD signature;
+    IMAGE_FILE_HEADER fileHeader;
+    if (!readHeader(data, size, offset, signature) || signature != IMAGE_NT_SIGNATURE || !readHeader(data, size, offset + sizeof(signature), fileHeader)) {
+        return {};
+    }
+    offset += sizeof(signature) + sizeof(fileHeader);
+    ModuleImage image;
+    image.machine = fileHeader.Machine;
+    image.timeDateStamp = fileHeader.TimeDateStamp;
+
+    // the optional header differs between 32 and 64 bit images
+    WORD magic;
+    if (!readHeader(data, size, offset, magic)) {
+        return {};
+    }
+    if (magic == IMAGE_NT_OPTIONAL_HDR32_MAGIC) {
+        IMAGE_OPTIONAL_HEADER32 optionalHeader;
+        if (!readHeader(data, size, offset, optionalHeader)) {
+            return {};
+        }
+        image.sizeOfImage = optionalHeader.SizeOfImage;
+        image.entryPoint = optionalHeader.AddressOfEntryPoint;
+    } else if (magic == IMAGE_NT_OPTIONAL_HDR64_MAGIC) {
+        IMAGE_OPTIONAL_HEADER64 optionalHeader;
+        if (!readHeader(data, size, offset, optionalHeader)) {
+            return {};
+        }
+        image.sizeOfImage = optionalHeader.SizeOfImage;
+        image.entryPoint = optionalHeader.AddressOfEntryPoint;
+    } else {
+        return {};
+    }
+    return image;
 }
 
-std::optional<MODULEINFO> libvsd::Module::info() const
+// maps the start of the file, the handle of LOAD_DLL_DEBUG_EVENT is only valid until the module is added
+std::optional<ModuleImage> readImage(HANDLE file, std::wstring &error)
 {
-    // the module needs to ble loaded already
-    if (!GetModuleInformation(m_parent->handle(), m_module, &m_info, sizeof(m_info))) {
-        m_error = L"(Error: GetModuleInformation: " + Utils::formatError(GetLastError()) + L")";
+    // the headers are at the start of the file
+    constexpr LONGLONG MaxHeaderSize = 64 * 1024;
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(file, &fileSize)) {
+        error = L"(Error: GetFileSizeEx: " + Utils::formatError(GetLastError()) + L")";
+        return {};
+    }
+    const auto size = static_cast<size_t>(fileSize.QuadPart < MaxHeaderSize ? fileSize.QuadPart : MaxHeaderSize);
+    HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!mapping) {
+        error = L"(Error: CreateFileMapping: " + Utils::formatError(GetLastError()) + L")";
+        return {};
+    }
+    const auto view = static_cast<const char *>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, size));
+    CloseHandle(mapping);
+    if (!view) {
+        error = L"(Error: MapViewOfFile: " + Utils::formatError(GetLastError()) + L")";
         return {};
     }
-    return m_info;
+    const auto image = parseImage(view, size);
+    UnmapViewOfFile(view);
+    if (!image) {
+        error = L"(Error: Invalid PE header)";
+    }
+    return image;
+}
+}
+
+Module::Module(const LOAD_DLL_DEBUG_INFO &info, const ModulePath *path)
+    : m_module(static_cast<HMODULE>(info.lpBaseOfDll))
+    , m_path(path)
+    , m_image(readImage(info.hFile, m_error))
+{
 }
 
 VSDChildProcess::VSDChildProcess(VSDClient *client, const unsigned long id, const HANDLE fileHandle)
-    : m_client(client)
-    , m_id(id)
-    , m_handle(OpenProcess(PROCESS_ALL_ACCESS, FALSE, id))
-    , m_path(Utils::getFinalPathNameByHandle(fileHandle))
-    , m_name(m_path.stem())
-    , m_args(getProcessArgs(m_handle, client))
-    , m_startTime(std::chrono::high_resolution_clock::now())
-    , m_exitCode(STILL_ACTIVE)
 {
+    reset(client, id, fileHandle);
 }
 
 VSDChildProcess::~VSDChildProcess()
 {
-    CloseHandle(m_handle);
+    close();
+}
+
+void VSDChildProcess::reset(VSDClient *client, const unsigned long id, const HANDLE fileHandle)
+{
+    m_client = client;
+    m_id = id;
+    m_handle = OpenProcess(PROCESS_ALL_ACCESS, FALSE, id);
+    m_path = Utils::getFinalPathNameByHandle(fileHandle);
+    m_name = m_path.stem().wstring();
+    m_utf8Name = Utils::wideCharToMultiByte(m_name);
+    m_prefix = m_utf8Name + "(" + std::to_string(m_id) + "): ";
+    m_argsRead = false;
+    m_args.clear();
+    m_error.clear();
+    m_startTime = std::chrono::high_resolution_clock::now();
+    m_duration = {};
+    m_exitCode = STILL_ACTIVE;
+}
+
+void VSDChildProcess::close()
+{
+    if (m_handle) {
+        CloseHandle(m_handle);
+        m_handle = nullptr;
+    }
+    m_modules.clear();
+    m_moduleIndex.clear();
+}
+
+const std::wstring &VSDChildProcess::arguments() const
+{
+    // the output thread and the debugger thread might ask at the same time
+    std::lock_guard<std::mutex> lock(m_argsMutex);
+    if (!m_argsRead) {
+        m_args = getProcessArgs(m_handle, m_client);
+        m_argsRead = true;
+    }
+    return m_args;
 }
 
 const std::chrono::high_resolution_clock::duration VSDChildProcess::time() const
@@ -134,50 +240,71 @@ void VSDChildProcess::stop()
     if (m_exitCode == STILL_ACTIVE) {
         std::wstringstream ws;
         ws << "Killing " << path() << " subprocess" << std::endl;
-        m_client->writeErr(ws.str());
+        m_client->writeErr(Utils::wideCharToMultiByte(ws.str()));
         TerminateProcess(handle(), 0);
     }
 }
 
 
-std::optional<Module> VSDChildProcess::getExceptionModule(void *address) const
+const Module *VSDChildProcess::getExceptionModule(void *address) const
 {
-    // find the module that comes after address
-    auto tmp = std::find_if(m_modules.cbegin(), m_modules.cend(), [address](const auto &other) {
-        const auto info = other.second.info();
-        if (!info) {
-            return false;
-        }
-        void *end = reinterpret_cast<char *>(info->lpBaseOfDll) + info->SizeOfImage;
-        return address == std::clamp(address, info->lpBaseOfDll, end);
-    });
-    if (tmp == m_modules.cend()) {
-        return {};
+    // the last module that starts at or before address
+    const auto pos = reinterpret_cast<uintptr_t>(address);
+    auto it = std::upper_bound(m_moduleIndex.cbegin(), m_moduleIndex.cend(), pos, [](uintptr_t value, const ModuleRange &other) { return value < other.begin; });
+    if (it == m_moduleIndex.cbegin()) {
+        return nullptr;
     }
-    return tmp->second;
+    --it;
+    return pos < it->end ? it->module : nullptr;
 }
 
-std::optional<Module> VSDChildProcess::getModul(HMODULE baseAddress) const
+const Module *VSDChildProcess::getModul(HMODULE baseAddress) const
 {
     const auto it = m_modules.find(baseAddress);
     if (it == m_modules.cend()) {
-        return {};
+        return nullptr;
     }
-    return it->second;
+    return &it->second;
 }
 
-std::optional<Module> VSDChildProcess::addModule(const LOAD_DLL_DEBUG_INFO &info)
+const Module *VSDChildProcess::addModule(const LOAD_DLL_DEBUG_INFO &info, VSDPathCache *paths)
 {
     const auto module = static_cast<HMODULE>(info.lpBaseOfDll);
     auto out = m_modules.find(module);
     if (info.hFile) {
         if (out == m_modules.cend()) {
-            out = m_modules.emplace(module, Module { info, this }).first;
+            // the header is read before the handle is closed
+            out = m_modules.emplace(module, Module { info, paths ? &paths->get(info.hFile) : nullptr }).first;
+            indexModule(out->second);
         }
         CloseHandle(info.hFile);
     }
     if (out == m_modules.cend()) {
-        return {};
+        return nullptr;
+    }
+    return &out->second;
+}
+
+void VSDChildProcess::removeModule(HMODULE baseAddress)
+{
+    const auto it = m_modules.find(baseAddress);
+    if (it == m_modules.cend()) {
+        return;
+    }
+    const Module *module = &it->second;
+    m_moduleIndex.erase(std::remove_if(m_moduleIndex.begin(), m_moduleIndex.end(), [module](const ModuleRange &range) { return range.module == module; }),
+                        m_moduleIndex.end());
+    m_modules.erase(it);
+}
+
+void VSDChildProcess::indexModule(const Module &module)
+{
+    // without a header the size of the module is unknown
+    if (!module.image()) {
+        return;
     }
-    return out->second;
+    const auto begin = reinterpret_cast<uintptr_t>(module.base());
+    const ModuleRange range { begin, begin + module.image()->sizeOfImage, &module };
+    m_moduleIndex.insert(
+        std::upper_bound(m_moduleIndex.begin(), m_moduleIndex.end(), begin, [](uintptr_t value, const ModuleRange &other) { return value < other.begin; }), range);
 }
@@ -22,12 +22,16 @@
 #define VSDCHILDPROCESS_H
 
 #include "vsd_exports.h"
+#include "vsdpathcache.h"
+#include "vsdringbuffer.h"
 
 #include <chrono>
 #include <filesystem>
 #include <map>
+#include <mutex>
 #include <optional>
 #include <string>
+#include <vector>
 
 #include <windows.h>
 
@@ -38,15 +42,43 @@ namespace libvsd {
 class VSDClient;
 class VSDChildProcess;
 
+// the metadata of a module, read once from the PE header of its file
+struct ModuleImage
+{
+    uint32_t sizeOfImage = 0;
+    uint32_t timeDateStamp = 0;
+    uint16_t machine = 0;
+    // relative to the base address, 0 for modules without an entry point
+    uint32_t entryPoint = 0;
+};
+
 class Module
 {
 public:
-    Module(const LOAD_DLL_DEBUG_INFO &info, VSDChildProcess *parent);
+    // path is null if the path of the module is not resolved
+    Module(const LOAD_DLL_DEBUG_INFO &info, const ModulePath *path);
 
-    std::optional<MODULEINFO> info() const;
+    inline HMODULE base() const
+    {
+        return m_module;
+    }
+    inline bool hasName() const
+    {
+        return m_path != nullptr;
+    }
     const auto &name() const
     {
-        return m_name;
+        return m_path->path;
+    }
+    // utf-8, for the output
+    const std::string &utf8Name() const
+    {
+        return m_path->utf8;
+    }
+    // empty if the header could not be read, the reason is in error()
+    inline const std::optional<ModuleImage> &image() const
+    {
+        return m_image;
     }
     const std::wstring &error() const
     {
@@ -54,11 +86,11 @@ public:
     }
 
 private:
-    VSDChildProcess *m_parent = nullptr;
     const HMODULE m_module = nullptr;
-    mutable std::wstring m_error;
-    mutable MODULEINFO m_info = {};
-    const std::filesystem::path m_name;
+    // shared with the modules of the other processes that load the same file
+    const ModulePath *m_path;
+    std::wstring m_error;
+    const std::optional<ModuleImage> m_image;
 };
 
 class LIBVSD_EXPORT VSDChildProcess
@@ -67,6 +99,11 @@ public:
     VSDChildProcess(VSDClient *client, const unsigned long id, const HANDLE fileHandle);
     virtual ~VSDChildProcess();
 
+    // the process objects are pooled, reset reuses a closed one for a new process
+    void reset(VSDClient *client, const unsigned long id, const HANDLE fileHandle);
+    // releases the handles and modules of the stopped process, the buffers are kept
+    void close();
+
     inline const HANDLE &handle() const
     {
         return m_handle;
@@ -82,7 +119,20 @@ public:
         return m_name;
     }
 
-    inline const std::wstring &arguments() const { return m_args; }
+    // utf-8, cached for the output
+    inline const std::string &utf8Name() const
+    {
+        return m_utf8Name;
+    }
+
+    // utf-8 "name(id): " the messages of the process are prefixed with
+    inline const std::string &prefix() const
+    {
+        return m_prefix;
+    }
+
+    // read from the process on first use, so the creation of the process doesn't wait for it
+    const std::wstring &arguments() const;
 
     inline const std::wstring &error() const
     {
@@ -109,26 +159,53 @@ public:
 
     void stop();
 
-    std::optional<Module> getExceptionModule(void *address) const;
+    // the returned modules stay valid until they are removed
+    const Module *getExceptionModule(void *address) const;
+
+    // without paths only the address range of the module is recorded
+    const Module *addModule(const LOAD_DLL_DEBUG_INFO &info, VSDPathCache *paths);
 
-    std::optional<Module> addModule(const LOAD_DLL_DEBUG_INFO &info);
+    const Module *getModul(HMODULE baseAddress) const;
 
-    std::optional<Module> getModul(HMODULE baseAddress) const;
+    void removeModule(HMODULE baseAddress);
+
+    // reusable buffer the OUTPUT_DEBUG_STRING_EVENT payloads are read into
+    inline VSDByteArena &debugBuffer()
+    {
+        return m_debugBuffer;
+    }
 
 private:
+    // [begin, end) of a loaded module
+    struct ModuleRange
+    {
+        uintptr_t begin;
+        uintptr_t end;
+        const Module *module;
+    };
+
+    void indexModule(const Module &module);
+
 #pragma warning(disable : 4251)
-    VSDClient *m_client;
-    unsigned long m_id;
-    HANDLE m_handle;
+    VSDClient *m_client = nullptr;
+    unsigned long m_id = 0;
+    HANDLE m_handle = nullptr;
     std::filesystem::path m_path;
     std::wstring m_name;
-    std::wstring m_args;
+    std::string m_utf8Name;
+    std::string m_prefix;
+    mutable std::mutex m_argsMutex;
+    mutable bool m_argsRead = false;
+    mutable std::wstring m_args;
     std::wstring m_error;
     std::chrono::high_resolution_clock::time_point m_startTime;
-    std::chrono::high_resolution_clock::duration m_duration;
+    std::chrono::high_resolution_clock::duration m_duration = {};
 
-    uint32_t m_exitCode;
+    uint32_t m_exitCode = STILL_ACTIVE;
     std::map<HMODULE, Module> m_modules;
+    // sorted by begin, for the lookup of the module an exception happened in
+    std::vector<ModuleRange> m_moduleIndex;
+    VSDByteArena m_debugBuffer;
 };
 
 }
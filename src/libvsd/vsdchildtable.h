@@ -0,0 +1,161 @@
+/*
+    VSD prints debugging messages of applications and their
+    sub-processes to console and supports logging of their output.
+    Copyright (C) 2026  Hannah von Reth <vonreth@kde.org>
+
+
+    VSD is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    VSD is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with VSD.  If not, see <http://www.gnu.org/licenses/>.
+    */
+
+
+#ifndef VSDCHILDTABLE_H
+#define VSDCHILDTABLE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace libvsd {
+class VSDChildProcess;
+
+// Open addressing hash table of the running processes keyed by their id, the lookup for each debug event is constant time.
+// Linear probing with backward shift deletion, so no tombstones pile up with thousands of short lived processes.
+class VSDChildTable
+{
+public:
+    VSDChildTable()
+    {
+        resize(MinCapacity);
+    }
+
+    // nullptr for unknown processes
+    inline VSDChildProcess *find(unsigned long id) const
+    {
+        for (size_t i = home(id);; i = next(i)) {
+            const Slot &slot = m_slots[i];
+            if (!slot.child || slot.id == id) {
+                return slot.child;
+            }
+        }
+    }
+
+    inline void insert(unsigned long id, VSDChildProcess *child)
+    {
+        // keep the load below one half, the clusters stay short
+        if ((m_size + 1) * 2 > m_slots.size()) {
+            resize(m_slots.size() * 2);
+        }
+        place(id, child);
+    }
+
+    inline void erase(unsigned long id)
+    {
+        size_t gap = home(id);
+        while (m_slots[gap].child && m_slots[gap].id != id) {
+            gap = next(gap);
+        }
+        if (!m_slots[gap].child) {
+            return;
+        }
+        // move the following entries of the cluster into the gap, unless that would put them before their home slot
+        for (size_t i = next(gap); m_slots[i].child; i = next(i)) {
+            const size_t slotHome = home(m_slots[i].id);
+            const bool between = gap < i ? gap < slotHome && slotHome <= i : gap < slotHome || slotHome <= i;
+            if (!between) {
+                m_slots[gap] = m_slots[i];
+                gap = i;
+            }
+        }
+        m_slots[gap] = Slot();
+        --m_size;
+    }
+
+    inline size_t size() const
+    {
+        return m_size;
+    }
+
+    inline bool empty() const
+    {
+        return m_size == 0;
+    }
+
+    template <typename Callback>
+    void forEach(Callback &&callback) const
+    {
+        for (const Slot &slot : m_slots) {
+            if (slot.child) {
+                callback(slot.child);
+            }
+        }
+    }
+
+private:
+    static constexpr size_t MinCapacity = 64;
+
+    struct Slot
+    {
+        unsigned long id = 0;
+        // nullptr for empty slots
+        VSDChildProcess *child = nullptr;
+    };
+
+    // fibonacci hashing, the ids are multiples of 4 so the low bits are useless
+    inline size_t home(unsigned long id) const
+    {
+        return static_cast<size_t>((static_cast<uint64_t>(id) * 0x9E3779B97F4A7C15ull) >> m_shift);
+    }
+
+    inline size_t next(size_t i) const
+    {
+        return (i + 1) & (m_slots.size() - 1);
+    }
+
+    inline void place(unsigned long id, VSDChildProcess *child)
+    {
+        size_t i = home(id);
+        while (m_slots[i].child && m_slots[i].id != id) {
+            i = next(i);
+        }
+        if (!m_slots[i].child) {
+            ++m_size;
+        }
+        m_slots[i] = { id, child };
+    }
+
+    void resize(size_t capacity)
+    {
+        std::vector<Slot> old(capacity);
+        old.swap(m_slots);
+        m_shift = 64;
+        for (size_t i = capacity; i > 1; i >>= 1) {
+            --m_shift;
+        }
+        m_size = 0;
+        for (const Slot &slot : old) {
+            if (slot.child) {
+                place(slot.id, slot.child);
+            }
+        }
+    }
+
+    std::vector<Slot> m_slots;
+    size_t m_size = 0;
+    // 64 - log2 of the capacity
+    int m_shift = 64;
+};
+
+}
+
+#endif // VSDCHILDTABLE_H
@@ -0,0 +1,428 @@
+/*
+    VSD prints debugging messages of applications and their
+    sub-processes to console and supports logging of their output.
+    Copyright (C) 2026  Hannah von Reth <vonreth@kde.org>
+
+
+    VSD is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    VSD is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with VSD.  If not, see <http://www.gnu.org/licenses/>.
+    */
+
+#include "vsddispatcher.h"
+#include "vsdchildprocess.h"
+#include "utils.h"
+
+using namespace libvsd;
+
+namespace {
+// number of events that can be queued before the debugger thread has to wait for the output thread
+constexpr size_t QueueSize = 4096;
+// with BackpressurePolicy::Sample every n-th message is kept while the queue is over its limit
+constexpr uint64_t SampleRate = 16;
+// maximal number of events passed to VSDClient::onEvents at once
+constexpr size_t MaxBatchSize = 256;
+// larger buffers of released records are freed, so the idle slots don't hold on to memory outside of the limit
+constexpr size_t MaxIdleCapacity = 256;
+}
+
+VSDDispatcher::VSDDispatcher(VSDClient *client, VSDChildPool *pool)
+    : m_client(client)
+    , m_pool(pool)
+    , m_debuggerQueue(QueueSize)
+    , m_pipeQueue(QueueSize)
+    , m_dataEvent(CreateEvent(nullptr, false, false, nullptr))
+    , m_spaceEvents { CreateEvent(nullptr, false, false, nullptr), CreateEvent(nullptr, false, false, nullptr) }
+{
+}
+
+VSDDispatcher::~VSDDispatcher()
+{
+    stop();
+    CloseHandle(m_dataEvent);
+    for (const auto event : m_spaceEvents) {
+        CloseHandle(event);
+    }
+}
+
+void VSDDispatcher::setBackpressure(VSDProcess::BackpressurePolicy policy, size_t maxQueuedBytes)
+{
+    m_policy = policy;
+    m_maxQueuedBytes = maxQueuedBytes;
+}
+
+void VSDDispatcher::start()
+{
+    m_producerThread = GetCurrentThreadId();
+    m_subscribed = m_client->subscribedEvents();
+    m_stop = false;
+    m_running = true;
+    m_thread = std::thread(&VSDDispatcher::run, this);
+}
+
+void VSDDispatcher::stop()
+{
+    if (!m_thread.joinable()) {
+        return;
+    }
+    m_stop = true;
+    SetEvent(m_dataEvent);
+    m_thread.join();
+
+    std::lock_guard<std::mutex> lock(m_orderMutex);
+    m_running = false;
+    for (auto &record : m_foreign) {
+        VSDRecord *batch = &record;
+        deliver(&batch, 1);
+    }
+    m_foreign.clear();
+    retire();
+}
+
+bool VSDDispatcher::admit(Source source, size_t size)
+{
+    const auto overLimit = [this, size](size_t limit) {
+        const size_t queued = m_queuedBytes;
+        // a single message is always accepted by an empty queue
+        return queued != 0 && queued + size > limit;
+    };
+    // sampling starts early enough to keep some messages below the limit
+    if (!overLimit(m_policy == VSDProcess::BackpressurePolicy::Sample ? m_maxQueuedBytes / 2 : m_maxQueuedBytes)) {
+        return true;
+    }
+    const int index = static_cast<int>(source);
+    switch (m_policy) {
+    case VSDProcess::BackpressurePolicy::Block:
+        while (overLimit(m_maxQueuedBytes)) {
+            m_waiting[index] = true;
+            // check again, the output thread might have freed the memory before it saw the flag
+            if (overLimit(m_maxQueuedBytes)) {
+                WaitForSingleObject(m_spaceEvents[index], INFINITE);
+            }
+        }
+        return true;
+    case VSDProcess::BackpressurePolicy::DropNewest:
+        return false;
+    case VSDProcess::BackpressurePolicy::DropOldest:
+        // the producer never waits, the output thread discards enough of the oldest messages
+        // before its next batch to make room, until then new messages are dropped
+        m_pendingBytes[index] = size;
+        SetEvent(m_dataEvent);
+        return false;
+    case VSDProcess::BackpressurePolicy::Sample:
+        return m_sampleCounter[index]++ % SampleRate == 0 && !overLimit(m_maxQueuedBytes);
+    }
+    return true;
+}
+
+void VSDDispatcher::drop(size_t size)
+{
+    ++m_droppedRecords;
+    m_droppedBytes += size;
+}
+
+VSDRecord *VSDDispatcher::beginRecord(Source source, VSDRecord::Type type, VSDChildProcess *process, size_t size)
+{
+    const bool droppable = type == VSDRecord::Type::Debug || source == Source::Pipes;
+    if (droppable && !admit(source, size)) {
+        drop(size);
+        return nullptr;
+    }
+    auto &q = queue(source);
+    VSDRecord *record = q.back();
+    while (!record) {
+        if (droppable && m_policy == VSDProcess::BackpressurePolicy::DropOldest) {
+            m_pendingSlot[static_cast<int>(source)] = true;
+            SetEvent(m_dataEvent);
+        }
+        if (droppable && m_policy != VSDProcess::BackpressurePolicy::Block) {
+            drop(size);
+            return nullptr;
+        }
+        WaitForSingleObject(m_spaceEvents[static_cast<int>(source)], INFINITE);
+        record = q.back();
+    }
+    record->type = type;
+    record->droppable = droppable;
+    record->timestamp = std::chrono::high_resolution_clock::now();
+    record->process = process;
+    record->tid = 0;
+    record->wide = false;
+    record->data.clear();
+    record->arena = nullptr;
+    return record;
+}
+
+void VSDDispatcher::commitRecord(Source source)
+{
+    auto &q = queue(source);
+    VSDRecord *record = q.back();
+    // the buffer of the record might be larger than its payload
+    record->footprint = record->arena ? record->view.size() : record->data.capacity();
+    m_queuedBytes += record->footprint;
+    bool wasEmpty;
+    {
+        // the sequence is taken when the record becomes visible, the payload might have taken a while
+        std::lock_guard<std::mutex> lock(m_orderMutex);
+        record->sequence = m_sequence++;
+        wasEmpty = q.push();
+    }
+    if (wasEmpty) {
+        SetEvent(m_dataEvent);
+    }
+}
+
+void VSDDispatcher::writeStdout(std::string_view data)
+{
+    post(VSDRecord::Type::Stdout, nullptr, data);
+}
+
+void VSDDispatcher::writeErr(std::string_view data)
+{
+    post(VSDRecord::Type::Stderr, nullptr, data);
+}
+
+void VSDDispatcher::writeDebug(const VSDChildProcess *process, std::string_view data)
+{
+    post(VSDRecord::Type::Debug, process, data);
+}
+
+void VSDDispatcher::writeDllLoad(const VSDChildProcess *process, std::string_view data, bool loading)
+{
+    post(loading ? VSDRecord::Type::DllLoad : VSDRecord::Type::DllUnload, process, data);
+}
+
+void VSDDispatcher::processStarted(const VSDChildProcess *process)
+{
+    post(VSDRecord::Type::ProcessStarted, process, {});
+}
+
+void VSDDispatcher::processStopped(const VSDChildProcess *process)
+{
+    post(VSDRecord::Type::ProcessStopped, process, {});
+}
+
+void VSDDispatcher::post(VSDRecord::Type type, const VSDChildProcess *process, std::string_view data)
+{
+    // the dispatcher holds the only non const reference to the processes
+    VSDChildProcess *child = const_cast<VSDChildProcess *>(process);
+    if (!m_running || GetCurrentThreadId() != m_producerThread) {
+        std::lock_guard<std::mutex> lock(m_orderMutex);
+        VSDRecord record;
+        record.type = type;
+        record.sequence = m_sequence++;
+        record.timestamp = std::chrono::high_resolution_clock::now();
+        record.process = child;
+        record.data = data;
+        if (!m_running) {
+            VSDRecord *batch = &record;
+            deliver(&batch, 1);
+            retire();
+            return;
+        }
+        m_foreign.push_back(std::move(record));
+        SetEvent(m_dataEvent);
+        return;
+    }
+    if (auto record = beginRecord(Source::Debugger, type, child, data.size())) {
+        record->data = data;
+        commitRecord(Source::Debugger);
+    }
+}
+
+void VSDDispatcher::toEvent(const VSDRecord &record, VSDEvent &event, std::string &scratch)
+{
+    event.type = record.type;
+    event.pid = record.process ? record.process->id() : 0;
+    event.tid = record.tid;
+    event.process = record.process;
+    event.timestamp = record.timestamp;
+    event.data = record.payload();
+    if (record.type == VSDRecord::Type::Debug) {
+        if (record.wide) {
+            // the only payload that needs to be transcoded
+            Utils::utf16ToUtf8(std::wstring_view(reinterpret_cast<const wchar_t *>(event.data.data()), event.data.size() / sizeof(wchar_t)), scratch);
+            event.data = scratch;
+        } else if (!Utils::isValidUtf8(event.data)) {
+            Utils::ansiToUtf8(event.data, scratch);
+            event.data = scratch;
+        }
+    }
+}
+
+void VSDDispatcher::deliver(VSDRecord *const *records, size_t count)
+{
+    if (count == 0) {
+        return;
+    }
+    m_events.resize(count);
+    if (m_scratch.size() < count) {
+        m_scratch.resize(count);
+    }
+    // stdout and stderr have to be read anyway, the other kinds are usually skipped by the debugger already
+    size_t events = 0;
+    for (size_t i = 0; i < count; ++i) {
+        if (m_subscribed & eventBit(records[i]->type)) {
+            toEvent(*records[i], m_events[events], m_scratch[events]);
+            ++events;
+        }
+    }
+    if (events) {
+        m_client->onEvents(m_events.data(), events);
+    }
+    for (size_t i = 0; i < count; ++i) {
+        if (records[i]->type == VSDRecord::Type::ProcessStopped) {
+            m_stopped.push_back(records[i]->process);
+            records[i]->process = nullptr;
+        }
+    }
+}
+
+VSDClient::EventMask VSDDispatcher::subscribedEvents() const
+{
+    return m_client->subscribedEvents();
+}
+
+void VSDDispatcher::retire()
+{
+    for (const auto process : m_stopped) {
+        m_pool->release(process);
+    }
+    m_stopped.clear();
+}
+
+void VSDDispatcher::release(Source source, VSDRecord &record)
+{
+    const int index = static_cast<int>(source);
+    m_queuedBytes -= record.footprint;
+    record.footprint = 0;
+    if (record.arena) {
+        record.arena->release(record.arenaEnd);
+    } else if (record.data.capacity() > MaxIdleCapacity) {
+        std::string().swap(record.data);
+    }
+    const bool wasFull = queue(source).pop();
+    if (wasFull || (m_waiting[index].load(std::memory_order_relaxed) && m_waiting[index].exchange(false))) {
+        SetEvent(m_spaceEvents[index]);
+    }
+}
+
+void VSDDispatcher::discard()
+{
+    for (const auto source : { Source::Debugger, Source::Pipes }) {
+        // the producer found its own queue full
+        VSDRecord *record = queue(source).front();
+        if (m_pendingSlot[static_cast<int>(source)].exchange(false) && record && record->droppable) {
+            drop(record->payload().size());
+            release(source, *record);
+        }
+    }
+    while (true) {
+        const size_t pending = m_pendingBytes[0] + m_pendingBytes[1];
+        if (pending == 0) {
+            return;
+        }
+        if (m_queuedBytes + pending <= m_maxQueuedBytes) {
+            // there is room for the next messages of the size that was dropped
+            m_pendingBytes[0] = 0;
+            m_pendingBytes[1] = 0;
+            return;
+        }
+        VSDRecord *debuggerRecord = m_debuggerQueue.front();
+        VSDRecord *pipeRecord = m_pipeQueue.front();
+        const Source source = !pipeRecord || (debuggerRecord && debuggerRecord->sequence < pipeRecord->sequence) ? Source::Debugger : Source::Pipes;
+        VSDRecord *record = source == Source::Debugger ? debuggerRecord : pipeRecord;
+        // only the front can be released, the regular delivery makes room behind process events
+        if (!record || !record->droppable) {
+            return;
+        }
+        drop(record->payload().size());
+        release(source, *record);
+    }
+}
+
+void VSDDispatcher::run()
+{
+    // the foreign records not delivered yet, ordered by their sequence
+    std::vector<VSDRecord> foreign;
+    size_t foreignDelivered = 0;
+    while (true) {
+        // read the flag before draining, everything posted before stop() is still delivered
+        const bool stopping = m_stop;
+
+        while (true) {
+            if (m_policy == VSDProcess::BackpressurePolicy::DropOldest) {
+                discard();
+            }
+            uint64_t visible;
+            {
+                std::lock_guard<std::mutex> lock(m_orderMutex);
+                for (auto &record : m_foreign) {
+                    foreign.push_back(std::move(record));
+                }
+                m_foreign.clear();
+                // a producer might be publishing a record with a higher sequence right now, but none with a lower one
+                visible = m_sequence;
+            }
+            // collect a batch merged from both queues and the foreign records,
+            // the records stay in the queues until the client is done with them
+            m_batch.clear();
+            m_batchSources.clear();
+            size_t offsets[2] = {};
+            size_t foreignOffset = foreignDelivered;
+            while (m_batch.size() < MaxBatchSize) {
+                VSDRecord *debuggerRecord = m_debuggerQueue.peek(offsets[0]);
+                VSDRecord *pipeRecord = m_pipeQueue.peek(offsets[1]);
+                VSDRecord *foreignRecord = foreignOffset < foreign.size() ? &foreign[foreignOffset] : nullptr;
+                VSDRecord *record = nullptr;
+                for (VSDRecord *candidate : { debuggerRecord, pipeRecord, foreignRecord }) {
+                    if (candidate && candidate->sequence < visible && (!record || candidate->sequence < record->sequence)) {
+                        record = candidate;
+                    }
+                }
+                if (!record) {
+                    break;
+                }
+                if (record == foreignRecord) {
+                    ++foreignOffset;
+                } else {
+                    const Source source = record == debuggerRecord ? Source::Debugger : Source::Pipes;
+                    ++offsets[static_cast<int>(source)];
+                    m_batchSources.push_back(source);
+                }
+                m_batch.push_back(record);
+            }
+            if (m_batch.empty()) {
+                if (!m_debuggerQueue.front() && !m_pipeQueue.front()) {
+                    break;
+                }
+                // a record was published after the sequence was read
+                continue;
+            }
+            deliver(m_batch.data(), m_batch.size());
+            // the records were taken from the queues in order, so releasing the front of each queue matches
+            for (const auto source : m_batchSources) {
+                release(source, *queue(source).front());
+            }
+            foreignDelivered = foreignOffset;
+            if (foreignDelivered == foreign.size()) {
+                foreign.clear();
+                foreignDelivered = 0;
+            }
+            retire();
+        }
+        if (stopping) {
+            return;
+        }
+        WaitForSingleObject(m_dataEvent, INFINITE);
+    }
+}
@@ -0,0 +1,175 @@
+/*
+    VSD prints debugging messages of applications and their
+    sub-processes to console and supports logging of their output.
+    Copyright (C) 2026  Hannah von Reth <vonreth@kde.org>
+
+
+    VSD is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    VSD is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with VSD.  If not, see <http://www.gnu.org/licenses/>.
+    */
+
+#ifndef VSDDISPATCHER_H
+#define VSDDISPATCHER_H
+
+#include "vsdchildpool.h"
+#include "vsdprocess.h"
+#include "vsdringbuffer.h"
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <windows.h>
+
+namespace libvsd {
+
+struct VSDRecord
+{
+    using Type = VSDEvent::Type;
+
+    Type type = Type::Stdout;
+    // used to merge the queues of the different producers in the order the events occurred
+    uint64_t sequence = 0;
+    std::chrono::high_resolution_clock::time_point timestamp;
+    VSDChildProcess *process = nullptr;
+    unsigned long tid = 0;
+    // the debug string was read from OutputDebugStringW and data holds utf-16
+    bool wide = false;
+    // might be discarded according to the backpressure policy
+    bool droppable = false;
+    // utf-8 payload
+    std::string data;
+    // set if the payload is a view into the arena of the process instead of data
+    VSDByteArena *arena = nullptr;
+    std::string_view view;
+    uint64_t arenaEnd = 0;
+    // the memory accounted for the backpressure limit
+    size_t footprint = 0;
+
+    inline std::string_view payload() const
+    {
+        return arena ? view : std::string_view(data);
+    }
+};
+
+// Decouples the debugger thread and the pipe reader from the VSDClient.
+// Each producer copies the event payload into its own ring buffer and can continue right away,
+// the output thread drains the ring buffers in batches into VSDClient::onEvents in the order the events occurred.
+class VSDDispatcher : public VSDClient
+{
+public:
+    enum class Source {
+        // the thread that called start()
+        Debugger,
+        // the thread reading stdout and stderr
+        Pipes
+    };
+
+    // the stopped processes are handed back to pool
+    VSDDispatcher(VSDClient *client, VSDChildPool *pool);
+    ~VSDDispatcher() override;
+
+    void setBackpressure(VSDProcess::BackpressurePolicy policy, size_t maxQueuedBytes);
+    inline uint64_t droppedRecords() const
+    {
+        return m_droppedRecords;
+    }
+    inline uint64_t droppedBytes() const
+    {
+        return m_droppedBytes;
+    }
+
+    // the calling thread becomes the Debugger producer
+    void start();
+    // delivers everything that is queued and joins the output thread
+    void stop();
+
+    // must only be called from the thread owning source, blocks while the queue is full
+    // stdout, stderr and debug messages of size bytes might get dropped according to the backpressure policy, then nullptr is returned
+    VSDRecord *beginRecord(Source source, VSDRecord::Type type, VSDChildProcess *process, size_t size = 0);
+    void commitRecord(Source source);
+
+    // VSDClient, the records are queued and delivered from the output thread
+    // processStopped returns the process to the pool once the stop was delivered
+    void writeStdout(std::string_view data) override;
+    void writeErr(std::string_view data) override;
+    void writeDebug(const VSDChildProcess *process, std::string_view data) override;
+    void writeDllLoad(const VSDChildProcess *process, std::string_view data, bool loading) override;
+    void processStarted(const VSDChildProcess *process) override;
+    void processStopped(const VSDChildProcess *process) override;
+    EventMask subscribedEvents() const override;
+
+private:
+    void post(VSDRecord::Type type, const VSDChildProcess *process, std::string_view data);
+    bool admit(Source source, size_t size);
+    void drop(size_t size);
+    // DropOldest: discards droppable records from the front of the queues to make room for the dropped new ones
+    void discard();
+    void toEvent(const VSDRecord &record, VSDEvent &event, std::string &scratch);
+    void deliver(VSDRecord *const *records, size_t count);
+    void release(Source source, VSDRecord &record);
+    // returns the processes stopped in the delivered batch to the pool, their buffers might be used by the records until then
+    void retire();
+    void run();
+
+    inline VSDRingBuffer<VSDRecord> &queue(Source source)
+    {
+        return source == Source::Debugger ? m_debuggerQueue : m_pipeQueue;
+    }
+
+    VSDClient *m_client;
+    VSDChildPool *m_pool;
+    // read from the client in start()
+    EventMask m_subscribed = AllEvents;
+    VSDRingBuffer<VSDRecord> m_debuggerQueue;
+    VSDRingBuffer<VSDRecord> m_pipeQueue;
+    HANDLE m_dataEvent;
+    HANDLE m_spaceEvents[2];
+    // a producer is waiting for the output thread to free memory
+    std::atomic<bool> m_waiting[2] = {};
+
+    VSDProcess::BackpressurePolicy m_policy = VSDProcess::BackpressurePolicy::Block;
+    size_t m_maxQueuedBytes = SIZE_MAX;
+    std::atomic<size_t> m_queuedBytes { 0 };
+    // DropOldest: the size of the last message each producer dropped because of the limit
+    std::atomic<size_t> m_pendingBytes[2] = {};
+    // DropOldest: a producer dropped a message because its queue was full
+    std::atomic<bool> m_pendingSlot[2] = {};
+    uint64_t m_sampleCounter[2] = {};
+    std::atomic<uint64_t> m_droppedRecords { 0 };
+    std::atomic<uint64_t> m_droppedBytes { 0 };
+    std::thread m_thread;
+    std::atomic<bool> m_running { false };
+    std::atomic<bool> m_stop { false };
+    DWORD m_producerThread = 0;
+
+    // taking the sequence number and publishing the record happens under the lock for all producers,
+    // so every record with a lower sequence than m_sequence is visible to the output thread
+    std::mutex m_orderMutex;
+    uint64_t m_sequence = 0;
+    // records posted from any other thread, like the one handling ctrl+c
+    std::vector<VSDRecord> m_foreign;
+
+    // the batch handed to the client, the buffers are reused
+    std::vector<VSDEvent> m_events;
+    std::vector<VSDRecord *> m_batch;
+    std::vector<Source> m_batchSources;
+    std::vector<VSDChildProcess *> m_stopped;
+    std::vector<std::string> m_scratch;
+};
+}
+
+#endif // VSDDISPATCHER_H
@@ -0,0 +1,111 @@
+/*
+    VSD prints debugging messages of applications and their
+    sub-processes to console and supports logging of their output.
+    Copyright (C) 2026  Hannah von Reth <vonreth@kde.org>
+
+
+    VSD is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    VSD is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with VSD.  If not, see <http://www.gnu.org/licenses/>.
+    */
+
+#ifndef VSDLINEFRAMER_H
+#define VSDLINEFRAMER_H
+
+#include <cstring>
+#include <string>
+#include <string_view>
+
+// Splits a stream of utf-8 chunks into lines.
+// Complete lines are passed on as views into the chunk, only lines spanning multiple chunks are copied
+// into a reusable carry buffer. Partial lines are only emitted on request and never split a utf-8 sequence.
+class VSDLineFramer
+{
+public:
+    VSDLineFramer(size_t maxLineLength)
+        : m_maxLineLength(maxLineLength)
+    {
+    }
+
+    // calls onLine for each complete line including its line break, the view is only valid during the call
+    template <typename Callback>
+    void feed(std::string_view data, Callback &&onLine)
+    {
+        const char *pos = data.data();
+        const char *const end = pos + data.size();
+        // memchr is vectorized by the crt
+        while (const char *eol = static_cast<const char *>(std::memchr(pos, '\n', end - pos))) {
+            ++eol;
+            if (m_carry.empty()) {
+                onLine(std::string_view(pos, eol - pos));
+            } else {
+                m_carry.append(pos, eol - pos);
+                onLine(std::string_view(m_carry));
+                m_carry.clear();
+            }
+            pos = eol;
+        }
+        m_carry.append(pos, end - pos);
+        if (m_carry.size() >= m_maxLineLength) {
+            flush(onLine);
+        }
+    }
+
+    inline bool hasPartialLine() const
+    {
+        return !m_carry.empty();
+    }
+
+    // emits the partial line up to the last complete utf-8 sequence
+    template <typename Callback>
+    void flush(Callback &&onLine)
+    {
+        const size_t size = completeUtf8Length(m_carry);
+        if (size) {
+            onLine(std::string_view(m_carry.data(), size));
+            m_carry.erase(0, size);
+        }
+    }
+
+    // emits everything, to be called at the end of the stream
+    template <typename Callback>
+    void finish(Callback &&onLine)
+    {
+        if (!m_carry.empty()) {
+            onLine(std::string_view(m_carry));
+            m_carry.clear();
+        }
+    }
+
+    // the length of data without a trailing incomplete utf-8 sequence
+    static size_t completeUtf8Length(std::string_view data)
+    {
+        size_t lead = data.size();
+        size_t continuation = 0;
+        while (lead > 0 && continuation < 3 && (static_cast<unsigned char>(data[lead - 1]) & 0xC0) == 0x80) {
+            --lead;
+            ++continuation;
+        }
+        if (lead == 0) {
+            return data.size();
+        }
+        const unsigned char c = static_cast<unsigned char>(data[lead - 1]);
+        const size_t expected = (c & 0xE0) == 0xC0 ? 2 : (c & 0xF0) == 0xE0 ? 3 : (c & 0xF8) == 0xF0 ? 4 : 1;
+        return continuation + 1 < expected ? lead - 1 : data.size();
+    }
+
+private:
+    const size_t m_maxLineLength;
+    std::string m_carry;
+};
+
+#endif // VSDLINEFRAMER_H
@@ -0,0 +1,52 @@
+/*
+    VSD prints debugging messages of applications and their
+    sub-processes to console and supports logging of their output.
+    Copyright (C) 2026  Hannah von Reth <vonreth@kde.org>
+
+
+    VSD is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    VSD is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with VSD.  If not, see <http://www.gnu.org/licenses/>.
+    */
+
+
+#include "vsdpathcache.h"
+#include "utils.h"
+
+using namespace libvsd;
+
+namespace {
+ModulePath resolve(HANDLE file)
+{
+    ModulePath out;
+    out.path = Utils::getFinalPathNameByHandle(file);
+    out.utf8 = Utils::wideCharToMultiByte(out.path.wstring());
+    return out;
+}
+}
+
+const ModulePath &VSDPathCache::get(HANDLE file)
+{
+    ++m_lookups;
+    BY_HANDLE_FILE_INFORMATION info;
+    if (!GetFileInformationByHandle(file, &info)) {
+        m_unidentified.push_back(resolve(file));
+        return m_unidentified.back();
+    }
+    const FileId id { info.dwVolumeSerialNumber, info.nFileIndexHigh, info.nFileIndexLow };
+    auto it = m_paths.find(id);
+    if (it != m_paths.end()) {
+        ++m_hits;
+        return it->second;
+    }
+    return m_paths.emplace(id, resolve(file)).first->second;
+}
@@ -0,0 +1,91 @@
+/*
+    VSD prints debugging messages of applications and their
+    sub-processes to console and supports logging of their output.
+    Copyright (C) 2026  Hannah von Reth <vonreth@kde.org>
+
+
+    VSD is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    VSD is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with VSD.  If not, see <http://www.gnu.org/licenses/>.
+    */
+
+
+#ifndef VSDPATHCACHE_H
+#define VSDPATHCACHE_H
+
+#include <deque>
+#include <filesystem>
+#include <string>
+#include <unordered_map>
+
+#include <windows.h>
+
+namespace libvsd {
+
+// the path of a module file, shared by all processes that load it
+struct ModulePath
+{
+    std::filesystem::path path;
+    // utf-8, for the output
+    std::string utf8;
+};
+
+// Interns the paths of the loaded modules by the identity of their file (volume serial and file index),
+// so a dll that is loaded by many processes is only resolved once.
+// The entries live as long as the cache, it is only used by the debugger thread.
+class VSDPathCache
+{
+public:
+    const ModulePath &get(HANDLE file);
+
+    inline uint64_t lookups() const
+    {
+        return m_lookups;
+    }
+
+    inline uint64_t hits() const
+    {
+        return m_hits;
+    }
+
+private:
+    struct FileId
+    {
+        DWORD volume;
+        DWORD indexHigh;
+        DWORD indexLow;
+
+        inline bool operator==(const FileId &other) const
+        {
+            return volume == other.volume && indexHigh == other.indexHigh && indexLow == other.indexLow;
+        }
+    };
+
+    struct FileIdHash
+    {
+        inline size_t operator()(const FileId &id) const
+        {
+            const uint64_t index = (static_cast<uint64_t>(id.indexHigh) << 32) | id.indexLow;
+            return std::hash<uint64_t>()(index ^ (static_cast<uint64_t>(id.volume) * 0x9E3779B97F4A7C15ull));
+        }
+    };
+
+    std::unordered_map<FileId, ModulePath, FileIdHash> m_paths;
+    // files without an identity are not shared
+    std::deque<ModulePath> m_unidentified;
+    uint64_t m_lookups = 0;
+    uint64_t m_hits = 0;
+};
+
+}
+
+#endif // VSDPATHCACHE_H
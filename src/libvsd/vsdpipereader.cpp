@@ -0,0 +1,168 @@
+/*
+    VSD prints debugging messages of applications and their
+    sub-processes to console and supports logging of their output.
+    Copyright (C) 2026  Hannah von Reth <vonreth@kde.org>
+
+
+    VSD is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    VSD is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with VSD.  If not, see <http://www.gnu.org/licenses/>.
+    */
+
+#include "vsdpipereader.h"
+#include "vsdpipe.h"
+
+#include <algorithm>
+
+using namespace libvsd;
+
+namespace {
+// how long a partial line is held back waiting for its line break
+constexpr DWORD PartialLineTimeout = 50;
+}
+
+VSDPipeReader::VSDPipeReader(VSDDispatcher *dispatcher)
+    : m_dispatcher(dispatcher)
+    , m_stopEvent(CreateEvent(nullptr, false, false, nullptr))
+{
+}
+
+VSDPipeReader::~VSDPipeReader()
+{
+    stop();
+    for (const auto &channel : m_channels) {
+        CloseHandle(channel.event);
+    }
+    CloseHandle(m_stopEvent);
+}
+
+void VSDPipeReader::start(VSDPipe *stdOut, VSDPipe *stdErr)
+{
+    for (auto pipe : { stdOut, stdErr }) {
+        if (!pipe) {
+            continue;
+        }
+        Channel channel;
+        channel.pipe = pipe;
+        channel.type = pipe == stdOut ? VSDRecord::Type::Stdout : VSDRecord::Type::Stderr;
+        // manual reset, ReadFile resets the event when a new read is started
+        channel.event = CreateEvent(nullptr, true, false, nullptr);
+        channel.buffer.resize(ReadBufferSize);
+        m_channels.push_back(std::move(channel));
+    }
+    m_thread = std::thread(&VSDPipeReader::run, this);
+}
+
+void VSDPipeReader::stop()
+{
+    if (!m_thread.joinable()) {
+        return;
+    }
+    SetEvent(m_stopEvent);
+    m_thread.join();
+}
+
+void VSDPipeReader::read(Channel &channel)
+{
+    if (!channel.closed) {
+        channel.pipe->overlapped = {};
+        channel.pipe->overlapped.hEvent = channel.event;
+        // a synchronous completion still signals the event, so both cases are handled in complete()
+        if (ReadFile(channel.pipe->hRead, channel.buffer.data(), ReadBufferSize, nullptr, &channel.pipe->overlapped) || GetLastError() == ERROR_IO_PENDING) {
+            channel.pending = true;
+            return;
+        }
+        channel.closed = true;
+    }
+    // nothing to wait for anymore
+    ResetEvent(channel.event);
+}
+
+void VSDPipeReader::complete(Channel &channel, bool wait)
+{
+    if (!channel.pending) {
+        return;
+    }
+    DWORD read = 0;
+    if (!GetOverlappedResult(channel.pipe->hRead, &channel.pipe->overlapped, &read, wait)) {
+        const DWORD error = GetLastError();
+        if (error == ERROR_IO_INCOMPLETE) {
+            return;
+        }
+        if (error != ERROR_OPERATION_ABORTED && error != ERROR_MORE_DATA) {
+            channel.closed = true;
+        }
+    }
+    channel.pending = false;
+    if (read > 0) {
+        channel.framer.feed(std::string_view(channel.buffer.data(), read), [this, &channel](std::string_view line) {
+            post(channel, line);
+        });
+    }
+}
+
+void VSDPipeReader::post(const Channel &channel, std::string_view line)
+{
+    if (VSDRecord *record = m_dispatcher->beginRecord(VSDDispatcher::Source::Pipes, channel.type, nullptr, line.size())) {
+        record->data.assign(line);
+        m_dispatcher->commitRecord(VSDDispatcher::Source::Pipes);
+    }
+}
+
+void VSDPipeReader::run()
+{
+    std::vector<HANDLE> handles { m_stopEvent };
+    for (auto &channel : m_channels) {
+        handles.push_back(channel.event);
+        read(channel);
+    }
+
+    while (true) {
+        const bool partial = std::any_of(m_channels.cbegin(), m_channels.cend(), [](const Channel &channel) {
+            return channel.framer.hasPartialLine();
+        });
+        const DWORD result = WaitForMultipleObjects(static_cast<DWORD>(handles.size()), handles.data(), false, partial ? PartialLineTimeout : INFINITE);
+        if (result == WAIT_TIMEOUT) {
+            for (auto &channel : m_channels) {
+                channel.framer.flush([this, &channel](std::string_view line) {
+                    post(channel, line);
+                });
+            }
+            continue;
+        }
+        const size_t index = result - WAIT_OBJECT_0;
+        if (index == 0 || index >= handles.size()) {
+            break;
+        }
+        auto &channel = m_channels[index - 1];
+        complete(channel, false);
+        if (!channel.pending) {
+            read(channel);
+        }
+    }
+
+    // collect the reads in flight and drain what the processes wrote before they exited
+    for (auto &channel : m_channels) {
+        if (channel.pending) {
+            CancelIoEx(channel.pipe->hRead, &channel.pipe->overlapped);
+            complete(channel, true);
+        }
+        DWORD available = 0;
+        while (!channel.closed && PeekNamedPipe(channel.pipe->hRead, nullptr, 0, nullptr, &available, nullptr) && available > 0) {
+            read(channel);
+            complete(channel, true);
+        }
+        channel.framer.finish([this, &channel](std::string_view line) {
+            post(channel, line);
+        });
+    }
+}
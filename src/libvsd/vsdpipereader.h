@@ -0,0 +1,77 @@
+/*
+    VSD prints debugging messages of applications and their
+    sub-processes to console and supports logging of their output.
+    Copyright (C) 2026  Hannah von Reth <vonreth@kde.org>
+
+
+    VSD is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    VSD is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with VSD.  If not, see <http://www.gnu.org/licenses/>.
+    */
+
+#ifndef VSDPIPEREADER_H
+#define VSDPIPEREADER_H
+
+#include "vsddispatcher.h"
+#include "vsdlineframer.h"
+
+#include <thread>
+#include <vector>
+
+#include <windows.h>
+
+class VSDPipe;
+
+namespace libvsd {
+
+// Reads stdout and stderr with overlapped io on its own thread and hands the data to the dispatcher
+// line by line as soon as a read completes.
+// A partial line is passed on once the pipe was idle for a moment, so prompts without a line break still show up.
+class VSDPipeReader
+{
+public:
+    VSDPipeReader(VSDDispatcher *dispatcher);
+    ~VSDPipeReader();
+
+    // stderr might be null if the channels are merged
+    void start(VSDPipe *stdOut, VSDPipe *stdErr);
+    // reads what is left in the pipes and joins the thread
+    void stop();
+
+private:
+    // size of the reusable read buffer of each pipe, longer lines are split
+    static constexpr DWORD ReadBufferSize = 64 * 1024;
+
+    struct Channel
+    {
+        VSDPipe *pipe = nullptr;
+        VSDRecord::Type type = VSDRecord::Type::Stdout;
+        HANDLE event = nullptr;
+        bool pending = false;
+        bool closed = false;
+        std::vector<char> buffer;
+        VSDLineFramer framer { ReadBufferSize };
+    };
+
+    void run();
+    void read(Channel &channel);
+    void complete(Channel &channel, bool wait);
+    void post(const Channel &channel, std::string_view line);
+
+    VSDDispatcher *m_dispatcher;
+    std::vector<Channel> m_channels;
+    HANDLE m_stopEvent;
+    std::thread m_thread;
+};
+}
+
+#endif // VSDPIPEREADER_H
@@ -20,8 +20,12 @@
 
 
 #include "vsdprocess.h"
+#include "vsdchildpool.h"
 #include "vsdchildprocess.h"
+#include "vsdchildtable.h"
+#include "vsddispatcher.h"
 #include "vsdpipe.h"
+#include "vsdpipereader.h"
 #include "utils.h"
 
 #include "3dparty/ceee/gflag_utils.h"
@@ -34,10 +38,10 @@
 
 
 #include <stdlib.h>
-#include <map>
 #include <time.h>
 #include <shlwapi.h>
 
+#include <atomic>
 #include <functional>
 
 using namespace libvsd;
@@ -79,17 +83,15 @@ std::wstring formatException(int exceptionCode)
 
 std::wstring getExceptionInfo(VSDChildProcess *process, const EXCEPTION_RECORD &rec)
 {
-    const auto module = process->getExceptionModule(rec.ExceptionAddress);
+    const Module *module = process->getExceptionModule(rec.ExceptionAddress);
     if (!module) {
         return L"(Error: Module not found)";
     }
-    const auto info = module->info();
-    if (!info) {
-        return module->error();
-    }
+    // without a subscription to dll events only the address range of the module is known
+    const std::filesystem::path name = module->hasName() ? module->name() : Utils::getModuleName(process->handle(), module->base());
     std::wstringstream oss;
     oss << formatException(rec.ExceptionCode) << " at address " << std::hex << std::showbase << reinterpret_cast<intptr_t>(rec.ExceptionAddress) << " in "
-        << module->name() << " loaded at base address " << reinterpret_cast<intptr_t>(info->lpBaseOfDll) << "\n"
+        << name << " loaded at base address " << reinterpret_cast<intptr_t>(module->base()) << "\n"
         << std::dec;
 
     if (rec.ExceptionCode == EXCEPTION_ACCESS_VIOLATION || rec.ExceptionCode == EXCEPTION_IN_PAGE_ERROR) {
@@ -122,6 +124,8 @@ class VSDProcess::PrivateVSDProcess
 public:
     PrivateVSDProcess(const std::wstring &program, const std::wstring &arguments, VSDClient *client)
         : m_client(client)
+        , m_dispatcher(client, &m_childPool)
+        , m_pipeReader(&m_dispatcher)
         , m_program(program)
         , m_arguments(arguments)
     {
@@ -144,7 +148,7 @@ public:
             if (!PathFindOnPathW(m_program.data(), nullptr)) {
                 std::wstringstream ws;
                 ws << "Couldn't find " << m_program << std::endl;
-                m_client->writeErr(ws.str());
+                m_client->writeErr(Utils::wideCharToMultiByte(ws.str()));
                 return;
             }
         }
@@ -157,77 +161,125 @@ public:
 
     inline void readDebugMSG(DEBUG_EVENT &debugEvent)
     {
-        VSDChildProcess *child = m_children[debugEvent.dwProcessId];
+        VSDChildProcess *child = m_children.find(debugEvent.dwProcessId);
+        if (!child || !subscribed(VSDEvent::Type::Debug)) {
+            return;
+        }
         const OUTPUT_DEBUG_STRING_INFO &DebugString = debugEvent.u.DebugString;
+        if (DebugString.nDebugStringLength == 0) {
+            return;
+        }
 
         // a std::string always appends the 0 character,
         // reading the full string would result and a 0 as part of the string
         const size_t size = DebugString.nDebugStringLength - 1;
 
-        std::wstring out;
-        if (DebugString.fUnicode == TRUE) {
-            out.resize(size / 2);
-            ReadProcessMemory(child->handle(), DebugString.lpDebugStringData, out.data(), size, nullptr);
+        // copy the payload before we continue the debuggee, the conversion happens on the output thread
+        VSDRecord *record = m_dispatcher.beginRecord(VSDDispatcher::Source::Debugger, VSDRecord::Type::Debug, child, size);
+        if (!record) {
+            // dropped according to the backpressure policy
+            return;
+        }
+        record->tid = debugEvent.dwThreadId;
+        record->wide = DebugString.fUnicode == TRUE;
+        // a partial read fails but still reports the number of bytes copied
+        SIZE_T read = 0;
+        BOOL ok;
+        if (char *buffer = child->debugBuffer().reserve(size, record->arenaEnd)) {
+            ok = ReadProcessMemory(child->handle(), DebugString.lpDebugStringData, buffer, size, &read);
+            record->arena = &child->debugBuffer();
+            record->view = std::string_view(buffer, read);
         } else {
-            std::string tmp(size, 0);
-            ReadProcessMemory(child->handle(), DebugString.lpDebugStringData, tmp.data(), size, nullptr);
-            out = Utils::multiByteToWideChar(tmp);
+            // the output thread is behind, fall back to the buffer of the record
+            record->data.resize(size);
+            ok = ReadProcessMemory(child->handle(), DebugString.lpDebugStringData, record->data.data(), size, &read);
+            record->data.resize(read);
         }
-
-        m_client->writeDebug(child, out);
+        if (!ok && read == 0) {
+            // the record is not committed, the next one reuses the slot
+            if (record->arena) {
+                record->arena->unreserve();
+            }
+            return;
+        }
+        m_dispatcher.commitRecord(VSDDispatcher::Source::Debugger);
     }
 
     inline void readProcessCreated(DEBUG_EVENT &debugEvent)
     {
-        VSDChildProcess *child = new VSDChildProcess(m_client, debugEvent.dwProcessId, debugEvent.u.CreateProcessInfo.hFile);
-        m_children[debugEvent.dwProcessId] = child;
-        m_client->processStarted(child);
+        VSDChildProcess *child = m_childPool.acquire(&m_dispatcher, debugEvent.dwProcessId, debugEvent.u.CreateProcessInfo.hFile);
+        m_children.insert(debugEvent.dwProcessId, child);
+        if (subscribed(VSDEvent::Type::ProcessStarted)) {
+            m_dispatcher.processStarted(child);
+        }
     }
 
     inline void cleanup(VSDChildProcess *child, DEBUG_EVENT &debugEvent)
     {
-        m_client->processStopped(child);
-        m_children.erase(child->id());
-        if (m_pi.dwProcessId == child->id()) {
+        const unsigned long id = child->id();
+        // the memory of the process is gone once the event is continued, so read the arguments now if nobody asked for them yet,
+        // only the process events carry them to the client
+        if (subscribed(VSDEvent::Type::ProcessStarted) || subscribed(VSDEvent::Type::ProcessStopped)) {
+            child->arguments();
+        }
+        m_children.erase(id);
+        if (m_pi.dwProcessId == id) {
             m_exitCode = debugEvent.u.ExitProcess.dwExitCode;
             m_time = child->time();
-
-            for (auto it : m_children) // first stop everything and then cleanup
-            {
-                it.second->stop();
-            }
-            readOutput(m_stdout);
-            readOutput(m_stderr);
         }
-        delete child;
+        // the dispatcher returns the child to the pool once the stop was delivered
+        m_dispatcher.processStopped(child);
+        if (m_pi.dwProcessId == id) {
+            // first stop everything and then cleanup
+            m_children.forEach([](VSDChildProcess *other) { other->stop(); });
+        }
     }
 
     inline void readProcessExited(DEBUG_EVENT &debugEvent)
     {
-        VSDChildProcess *child = m_children[debugEvent.dwProcessId];
+        VSDChildProcess *child = m_children.find(debugEvent.dwProcessId);
+        if (!child) {
+            return;
+        }
         child->processStopped(debugEvent.u.ExitProcess.dwExitCode);
         cleanup(child, debugEvent);
     }
 
     inline void dllLoadEvent(DEBUG_EVENT &debugEvent)
     {
-        VSDChildProcess *child = m_children.at(debugEvent.dwProcessId);
-        const auto &module = child->addModule(debugEvent.u.LoadDll);
-        m_client->writeDllLoad(child, module ? module->name() : L"Unknown", true);
+        VSDChildProcess *child = m_children.find(debugEvent.dwProcessId);
+        if (!child) {
+            return;
+        }
+        if (!subscribed(VSDEvent::Type::DllLoad)) {
+            // only the address range is needed for exceptions, the path is resolved if one happens
+            child->addModule(debugEvent.u.LoadDll, nullptr);
+            return;
+        }
+        const Module *module = child->addModule(debugEvent.u.LoadDll, &m_modulePaths);
+        m_dispatcher.writeDllLoad(child, module ? std::string_view(module->utf8Name()) : "Unknown", true);
     }
 
     inline void dllUnloadEvent(DEBUG_EVENT &debugEvent)
     {
-        VSDChildProcess *child = m_children.at(debugEvent.dwProcessId);
-        const auto module = child->getModul(static_cast<HMODULE>(debugEvent.u.UnloadDll.lpBaseOfDll));
-        m_client->writeDllLoad(child, module ? module->name() : L"Unknown", false);
+        VSDChildProcess *child = m_children.find(debugEvent.dwProcessId);
+        if (!child) {
+            return;
+        }
+        const auto base = static_cast<HMODULE>(debugEvent.u.UnloadDll.lpBaseOfDll);
+        if (subscribed(VSDEvent::Type::DllUnload)) {
+            const Module *module = child->getModul(base);
+            m_dispatcher.writeDllLoad(child, module && module->hasName() ? std::string_view(module->utf8Name()) : "Unknown", false);
+        }
+        // the address range can be reused by the next module
+        child->removeModule(base);
     }
 
     inline DWORD readException(DEBUG_EVENT &debugEvent)
     {
-        VSDChildProcess *child = m_children[debugEvent.dwProcessId];
+        VSDChildProcess *child = m_children.find(debugEvent.dwProcessId);
 
-        if (debugEvent.u.Exception.dwFirstChance == 0) {
+        if (child && debugEvent.u.Exception.dwFirstChance == 0) {
             std::wstringstream out;
             out << L"Unhandled Exception: ";
             out << getExceptionInfo(child, debugEvent.u.Exception.ExceptionRecord);
@@ -239,32 +291,14 @@ public:
 
     inline void readProcessRip(DEBUG_EVENT &debugEvent)
     {
-        VSDChildProcess *child = m_children[debugEvent.dwProcessId];
+        VSDChildProcess *child = m_children.find(debugEvent.dwProcessId);
+        if (!child) {
+            return;
+        }
         child->processDied(debugEvent.u.ExitProcess.dwExitCode, debugEvent.u.RipInfo.dwError);
         cleanup(child, debugEvent);
     }
 
-    inline void readOutput(VSDPipe *p)
-    {
-        if (p) {
-            BOOL bSuccess = FALSE;
-            DWORD dwRead;
-            bSuccess = PeekNamedPipe(p->hRead, nullptr, 0, nullptr, &dwRead, nullptr);
-            if (bSuccess && dwRead > 0) {
-                std::string tmp(dwRead, 0);
-                if (ReadFile(p->hRead, tmp.data(), dwRead, nullptr, &p->overlapped)) {
-                    std::wstring out = Utils::multiByteToWideChar(tmp);
-
-                    if (p == m_stdout) {
-                        m_client->writeStdout(out);
-                    } else {
-                        m_client->writeErr(out);
-                    }
-                }
-            }
-        }
-    }
-
     int run(VSDProcess::ProcessChannelMode channelMode)
     {
         if (m_program.empty()) {
@@ -304,13 +338,17 @@ public:
         if (!SUCCEEDED(hr)) {
             std::wstringstream ws;
             ws << "Failed to start " << m_program << " " << m_arguments << " " << std::hex << hr << std::dec << Utils::formatError(hr) << std::endl;
-            m_client->writeErr(ws.str());
+            m_client->writeErr(Utils::wideCharToMultiByte(ws.str()));
             return -1;
         }
 
         DEBUG_EVENT debug_event = {};
         DWORD status = DBG_CONTINUE;
 
+        m_subscribed = m_client->subscribedEvents();
+        m_dispatcher.start();
+        m_pipeReader.start(m_stdout, m_stderr);
+
 
         typedef BOOL(WINAPI * debug_wait)(LPDEBUG_EVENT, DWORD);
 
@@ -323,11 +361,7 @@ public:
 
         do {
             status = DBG_CONTINUE;
-            readOutput(m_stdout);
-            readOutput(m_stderr);
             if ((*waitForDebug)(&debug_event, 500)) {
-                readOutput(m_stdout);
-                readOutput(m_stderr);
                 switch (debug_event.dwDebugEventCode) {
                 case OUTPUT_DEBUG_STRING_EVENT:
                     readDebugMSG(debug_event);
@@ -355,7 +389,14 @@ public:
                 }
             }
             ContinueDebugEvent(debug_event.dwProcessId, debug_event.dwThreadId, status);
-        } while (m_children.size() > 0);
+            if (m_killRequested.exchange(false)) {
+                if (VSDChildProcess *child = m_children.find(m_pi.dwProcessId)) {
+                    child->stop();
+                }
+            }
+        } while (!m_children.empty());
+        m_pipeReader.stop();
+        m_dispatcher.stop();
 
         CloseHandle(m_pi.hProcess);
         CloseHandle(m_pi.hThread);
@@ -385,21 +426,31 @@ public:
     {
         EnumWindows(shutdown, m_pi.dwProcessId);
         if (WaitForSingleObject(SHUTDOWN_EVENT, 50) != WAIT_OBJECT_0) {
-            m_client->writeErr(L"Failed to post WM_CLOSE message\n");
-            m_children[m_pi.dwProcessId]->stop();
+            m_dispatcher.writeErr("Failed to post WM_CLOSE message\n");
+            m_killRequested = true;
             return;
         }
         if (FAILED(PostThreadMessage(m_pi.dwThreadId, WM_CLOSE, 0, 0)) || FAILED(PostThreadMessage(m_pi.dwThreadId, WM_QUIT, 0, 0))) {
-            m_client->writeErr(L"Failed to post thred message\n");
+            m_dispatcher.writeErr("Failed to post thred message\n");
         }
 
         if (WaitForSingleObject(m_pi.hProcess, 10000) == WAIT_TIMEOUT) {
-            m_children[m_pi.dwProcessId]->stop();
+            m_killRequested = true;
         }
     }
 
 
+    inline bool subscribed(VSDEvent::Type type) const
+    {
+        return m_subscribed & VSDClient::eventBit(type);
+    }
+
     VSDClient *m_client;
+    VSDClient::EventMask m_subscribed = VSDClient::AllEvents;
+    // declared before the dispatcher, which returns the stopped children to it
+    VSDChildPool m_childPool;
+    VSDDispatcher m_dispatcher;
+    VSDPipeReader m_pipeReader;
     std::wstring m_program;
     std::wstring m_arguments;
     bool m_debugSubProcess = false;
@@ -413,7 +464,12 @@ public:
     VSDPipe *m_stdout = nullptr;
     VSDPipe *m_stderr = nullptr;
 
-    std::map<unsigned long, VSDChildProcess *> m_children;
+    // the running children, owned by m_childPool and only accessed by the debugger thread
+    VSDChildTable m_children;
+    // stop() is called from another thread, the debugger thread kills the process within the timeout of WaitForDebugEvent
+    std::atomic<bool> m_killRequested { false };
+    // shared by the modules of all children
+    VSDPathCache m_modulePaths;
 };
 
 VSDClient::VSDClient()
@@ -424,6 +480,89 @@ VSDClient::~VSDClient()
 {
 }
 
+VSDClient::EventMask VSDClient::subscribedEvents() const
+{
+    return AllEvents;
+}
+
+// the adapters call the deprecated utf-16 interface on purpose
+#ifdef _MSC_VER
+#pragma warning(push)
+#pragma warning(disable : 4996)
+#else
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wdeprecated-declarations"
+#endif
+void VSDClient::writeStdout(std::string_view data)
+{
+    writeStdout(Utils::multiByteToWideChar(data));
+}
+
+void VSDClient::writeErr(std::string_view data)
+{
+    writeErr(Utils::multiByteToWideChar(data));
+}
+
+void VSDClient::writeDebug(const VSDChildProcess *process, std::string_view data)
+{
+    writeDebug(process, Utils::multiByteToWideChar(data));
+}
+
+void VSDClient::writeDllLoad(const VSDChildProcess *process, std::string_view data, bool loading)
+{
+    writeDllLoad(process, Utils::multiByteToWideChar(data), loading);
+}
+#ifdef _MSC_VER
+#pragma warning(pop)
+#else
+#pragma GCC diagnostic pop
+#endif
+
+void VSDClient::writeStdout(const std::wstring &)
+{
+}
+
+void VSDClient::writeErr(const std::wstring &)
+{
+}
+
+void VSDClient::writeDebug(const VSDChildProcess *, const std::wstring &)
+{
+}
+
+void VSDClient::writeDllLoad(const VSDChildProcess *, const std::wstring &, bool)
+{
+}
+
+void VSDClient::onEvents(const VSDEvent *events, size_t count)
+{
+    for (const VSDEvent *event = events; event != events + count; ++event) {
+        switch (event->type) {
+        case VSDEvent::Type::Stdout:
+            writeStdout(event->data);
+            break;
+        case VSDEvent::Type::Stderr:
+            writeErr(event->data);
+            break;
+        case VSDEvent::Type::Debug:
+            writeDebug(event->process, event->data);
+            break;
+        case VSDEvent::Type::DllLoad:
+            writeDllLoad(event->process, event->data, true);
+            break;
+        case VSDEvent::Type::DllUnload:
+            writeDllLoad(event->process, event->data, false);
+            break;
+        case VSDEvent::Type::ProcessStarted:
+            processStarted(event->process);
+            break;
+        case VSDEvent::Type::ProcessStopped:
+            processStopped(event->process);
+            break;
+        }
+    }
+}
+
 VSDProcess::VSDProcess(const std::wstring &program, const std::wstring &arguments, VSDClient *client)
     : d(new PrivateVSDProcess(program, arguments, client))
 {
@@ -459,6 +598,31 @@ void VSDProcess::debugDllLoading(bool b)
     }
 }
 
+void VSDProcess::setBackpressure(BackpressurePolicy policy, size_t maxQueuedBytes)
+{
+    d->m_dispatcher.setBackpressure(policy, maxQueuedBytes);
+}
+
+uint64_t VSDProcess::droppedRecords() const
+{
+    return d->m_dispatcher.droppedRecords();
+}
+
+uint64_t VSDProcess::droppedBytes() const
+{
+    return d->m_dispatcher.droppedBytes();
+}
+
+uint64_t VSDProcess::modulePathLookups() const
+{
+    return d->m_modulePaths.lookups();
+}
+
+uint64_t VSDProcess::modulePathCacheHits() const
+{
+    return d->m_modulePaths.hits();
+}
+
 const std::wstring &VSDProcess::program() const
 {
     return d->m_program;
@@ -25,24 +25,72 @@
 
 #include <windows.h>
 #include <string>
+#include <string_view>
 #include <sstream>
 #include <chrono>
+#include <cstdint>
 
 namespace libvsd {
 
 class VSDChildProcess;
 
+struct VSDEvent
+{
+    enum class Type {
+        Stdout,
+        Stderr,
+        Debug,
+        DllLoad,
+        DllUnload,
+        ProcessStarted,
+        ProcessStopped
+    };
+
+    Type type;
+    // stdout and stderr are shared by all processes, so they have no process and a pid of 0
+    unsigned long pid;
+    // the thread that emitted a debug message, 0 for all other events
+    unsigned long tid;
+    const VSDChildProcess *process;
+    // the time the event was captured
+    std::chrono::high_resolution_clock::time_point timestamp;
+    // utf-8, the message for Stdout, Stderr and Debug, the module for DllLoad and DllUnload
+    std::string_view data;
+};
+
+// All text is passed as utf-8, the views are only valid during the call
 class LIBVSD_EXPORT VSDClient
 {
 public:
+    // one bit per VSDEvent::Type
+    using EventMask = uint32_t;
+    static constexpr EventMask AllEvents = ~EventMask(0);
+    static constexpr EventMask eventBit(VSDEvent::Type type)
+    {
+        return EventMask(1) << static_cast<int>(type);
+    }
+
     VSDClient();
     virtual ~VSDClient();
-    virtual void writeStdout(const std::wstring &data) = 0;
-    virtual void writeErr(const std::wstring &data) = 0;
-    virtual void writeDebug(const VSDChildProcess *process, const std::wstring &data) = 0;
-    virtual void writeDllLoad(const VSDChildProcess *process, const std::wstring &data, bool loading) = 0;
+    // Queried once when the process is started. Events of other kinds are not delivered
+    // and the debugger skips reading and resolving them, by default all events are delivered.
+    virtual EventMask subscribedEvents() const;
+    // Called from the output thread with all events that are ready.
+    // The default implementation calls the functions below for each event.
+    virtual void onEvents(const VSDEvent *events, size_t count);
+    // the default implementations convert to utf-16 and call the deprecated overloads below
+    virtual void writeStdout(std::string_view data);
+    virtual void writeErr(std::string_view data);
+    virtual void writeDebug(const VSDChildProcess *process, std::string_view data);
+    virtual void writeDllLoad(const VSDChildProcess *process, std::string_view data, bool loading);
     virtual void processStarted(const VSDChildProcess *process) = 0;
     virtual void processStopped(const VSDChildProcess *process) = 0;
+
+    // the utf-16 interface of vsd 0.9, only kept for existing clients
+    [[deprecated("override the std::string_view overload")]] virtual void writeStdout(const std::wstring &data);
+    [[deprecated("override the std::string_view overload")]] virtual void writeErr(const std::wstring &data);
+    [[deprecated("override the std::string_view overload")]] virtual void writeDebug(const VSDChildProcess *process, const std::wstring &data);
+    [[deprecated("override the std::string_view overload")]] virtual void writeDllLoad(const VSDChildProcess *process, const std::wstring &data, bool loading);
 };
 
 class LIBVSD_EXPORT VSDProcess
@@ -54,6 +102,18 @@ public:
 
     };
 
+    // what happens to stdout, stderr and debug messages once the output can't keep up
+    enum class BackpressurePolicy {
+        // stall the debuggee until the output caught up
+        Block,
+        // discard the oldest queued messages to make room, new ones are discarded until the output thread made room
+        DropOldest,
+        // discard new messages
+        DropNewest,
+        // keep every 16th new message once half of the memory is used
+        Sample
+    };
+
     VSDProcess(const std::wstring &program, const std::wstring &arguments, VSDClient *client);
     virtual ~VSDProcess();
 
@@ -61,6 +121,13 @@ public:
     void stop();
     void debugSubProcess(bool b);
     void debugDllLoading(bool b);
+    // maxQueuedBytes limits the memory of the messages waiting for the output
+    void setBackpressure(BackpressurePolicy policy, size_t maxQueuedBytes);
+    uint64_t droppedRecords() const;
+    uint64_t droppedBytes() const;
+    // the paths of modules loaded by several processes are resolved only once
+    uint64_t modulePathLookups() const;
+    uint64_t modulePathCacheHits() const;
     const std::wstring &program() const;
     const std::wstring &arguments() const;
     int exitCode() const;
@@ -0,0 +1,170 @@
+/*
+    VSD prints debugging messages of applications and their
+    sub-processes to console and supports logging of their output.
+    Copyright (C) 2026  Hannah von Reth <vonreth@kde.org>
+
+
+    VSD is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    VSD is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with VSD.  If not, see <http://www.gnu.org/licenses/>.
+    */
+
+#ifndef VSDRINGBUFFER_H
+#define VSDRINGBUFFER_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+// Bounded lock-free single producer single consumer queue.
+// The slots are reused in place, so containers inside of T keep their capacity between rounds.
+template <typename T>
+class VSDRingBuffer
+{
+public:
+    VSDRingBuffer(size_t capacity)
+    {
+        size_t size = 1;
+        while (size < capacity) {
+            size <<= 1;
+        }
+        m_data.resize(size);
+        m_mask = size - 1;
+    }
+
+    inline size_t capacity() const
+    {
+        return m_data.size();
+    }
+
+    inline size_t size() const
+    {
+        return m_head.load() - m_tail.load();
+    }
+
+    // producer: returns the next free slot or nullptr if the queue is full
+    inline T *back()
+    {
+        const size_t head = m_head.load(std::memory_order_relaxed);
+        if (head - m_tail.load() == m_data.size()) {
+            return nullptr;
+        }
+        return &m_data[head & m_mask];
+    }
+
+    // producer: publishes the slot returned by back(), returns true if the queue was empty before
+    inline bool push()
+    {
+        const size_t head = m_head.load(std::memory_order_relaxed);
+        m_head.store(head + 1);
+        return m_tail.load() == head;
+    }
+
+    // consumer: returns the oldest slot or nullptr if the queue is empty
+    inline T *front()
+    {
+        const size_t tail = m_tail.load(std::memory_order_relaxed);
+        if (tail == m_head.load()) {
+            return nullptr;
+        }
+        return &m_data[tail & m_mask];
+    }
+
+    // consumer: returns the slot offset positions behind the oldest one or nullptr
+    inline T *peek(size_t offset)
+    {
+        const size_t tail = m_tail.load(std::memory_order_relaxed);
+        if (m_head.load() - tail <= offset) {
+            return nullptr;
+        }
+        return &m_data[(tail + offset) & m_mask];
+    }
+
+    // consumer: releases the slot returned by front(), returns true if the queue was full before
+    inline bool pop()
+    {
+        const size_t tail = m_tail.load(std::memory_order_relaxed);
+        m_tail.store(tail + 1);
+        return m_head.load() - tail == m_data.size();
+    }
+
+private:
+    // the default sequential consistent ordering is required for the empty and full notifications in push and pop
+    alignas(64) std::atomic<size_t> m_head { 0 };
+    alignas(64) std::atomic<size_t> m_tail { 0 };
+    std::vector<T> m_data;
+    size_t m_mask = 0;
+};
+
+// Single producer single consumer arena for variable sized payloads.
+// The producer reserves contiguous blocks and hands them on as views, the consumer releases them in the same order.
+// The arena is allocated on first use and only grows while it is drained, so views are never invalidated.
+class VSDByteArena
+{
+public:
+    static constexpr size_t MinCapacity = 16 * 1024;
+    static constexpr size_t MaxCapacity = 1024 * 1024;
+
+    // producer: returns nullptr if the block doesn't fit right now, end must be passed to release()
+    inline char *reserve(size_t size, uint64_t &end)
+    {
+        // keep the blocks aligned, the payload might be utf-16
+        size = (size + 7) & ~size_t(7);
+        if (m_head == m_tail.load(std::memory_order_acquire) && (m_grow || m_data.size() < size)) {
+            // nothing is referenced, so the buffer can be reallocated
+            size_t capacity = m_data.empty() ? MinCapacity : m_data.size();
+            while (capacity < size || (m_grow && capacity == m_data.size() && capacity < MaxCapacity)) {
+                capacity *= 2;
+            }
+            m_data.resize(capacity);
+            m_head = 0;
+            m_tail.store(0, std::memory_order_relaxed);
+            m_grow = false;
+        }
+        const size_t capacity = m_data.size();
+        const size_t offset = m_head % capacity;
+        // a block is never split, the rest of the buffer is skipped if it is too small
+        const size_t skip = capacity - offset < size ? capacity - offset : 0;
+        if (m_head + skip + size - m_tail.load(std::memory_order_acquire) > capacity) {
+            // grow the next time the consumer caught up
+            m_grow = capacity < MaxCapacity;
+            return nullptr;
+        }
+        m_reservedFrom = m_head;
+        m_head += skip + size;
+        end = m_head;
+        return m_data.data() + (skip ? 0 : offset);
+    }
+
+    // producer: gives back the block of the last successful reserve(), if it was never handed on
+    inline void unreserve()
+    {
+        m_head = m_reservedFrom;
+    }
+
+    // consumer: releases all blocks up to end
+    inline void release(uint64_t end)
+    {
+        m_tail.store(end, std::memory_order_release);
+    }
+
+private:
+    std::vector<char> m_data;
+    uint64_t m_head = 0;
+    // the head before the last reserve()
+    uint64_t m_reservedFrom = 0;
+    bool m_grow = false;
+    alignas(64) std::atomic<uint64_t> m_tail { 0 };
+};
+
+#endif // VSDRINGBUFFER_H
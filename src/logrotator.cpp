@@ -0,0 +1,148 @@
+/*
+    VSD prints debugging messages of applications and their
+    sub-processes to console and supports logging of their output.
+    Copyright (C) 2026  Hannah von Reth <vonreth@kde.org>
+
+
+    VSD is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    VSD is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with VSD.  If not, see <http://www.gnu.org/licenses/>.
+    */
+
+
+#include "logrotator.h"
+
+#include <fstream>
+#include <vector>
+
+#include <zlib.h>
+
+namespace {
+std::filesystem::path compressedPath(const std::filesystem::path &path)
+{
+    auto out = path;
+    out += ".gz";
+    return out;
+}
+
+// returns false if the segment should be kept as it is
+bool compress(const std::filesystem::path &path)
+{
+    std::ifstream in(path, std::ios::in | std::ios::binary);
+    gzFile out = gzopen_w(compressedPath(path).wstring().c_str(), "wb");
+    if (!in || !out) {
+        return false;
+    }
+    std::vector<char> buffer(1024 * 1024);
+    bool ok = true;
+    while (ok && in) {
+        in.read(buffer.data(), buffer.size());
+        if (in.gcount() > 0) {
+            ok = gzwrite(out, buffer.data(), static_cast<unsigned>(in.gcount())) > 0;
+        }
+    }
+    ok = gzclose(out) == Z_OK && ok;
+    if (!ok) {
+        std::error_code error;
+        std::filesystem::remove(compressedPath(path), error);
+    }
+    return ok;
+}
+}
+
+LogRotator::LogRotator(const std::filesystem::path &path, const Policy &policy)
+    : m_path(path)
+    , m_policy(policy)
+    , m_current(policy.enabled() ? segmentPath(m_index) : path)
+    , m_segmentStart(std::chrono::steady_clock::now())
+{
+    if (m_policy.enabled()) {
+        m_thread = std::thread([this] { run(); });
+    }
+}
+
+LogRotator::~LogRotator()
+{
+    if (m_thread.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stop = true;
+        }
+        m_wakeUp.notify_one();
+        m_thread.join();
+    }
+}
+
+const std::filesystem::path &LogRotator::currentPath() const
+{
+    return m_current;
+}
+
+bool LogRotator::shouldRotate(uint64_t segmentSize) const
+{
+    if (m_policy.maxSize > 0 && segmentSize >= m_policy.maxSize) {
+        return true;
+    }
+    return m_policy.interval.count() > 0 && std::chrono::steady_clock::now() - m_segmentStart >= m_policy.interval;
+}
+
+const std::filesystem::path &LogRotator::next()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_policy.compress) {
+            m_tasks.push_back({ Task::Type::Compress, m_current });
+        }
+        if (m_index + 1 > m_policy.keep) {
+            m_tasks.push_back({ Task::Type::Remove, segmentPath(m_index + 1 - m_policy.keep) });
+        }
+    }
+    m_wakeUp.notify_one();
+    m_current = segmentPath(++m_index);
+    m_segmentStart = std::chrono::steady_clock::now();
+    return m_current;
+}
+
+std::filesystem::path LogRotator::segmentPath(uint64_t index) const
+{
+    auto path = m_path;
+    path.replace_extension(std::to_wstring(index) + m_path.extension().wstring());
+    return path;
+}
+
+void LogRotator::run()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (true) {
+        m_wakeUp.wait(lock, [this] { return m_stop || !m_tasks.empty(); });
+        if (m_tasks.empty()) {
+            return;
+        }
+        const Task task = std::move(m_tasks.front());
+        m_tasks.pop_front();
+        lock.unlock();
+        std::error_code error;
+        switch (task.type) {
+        case Task::Type::Compress:
+            if (compress(task.path)) {
+                std::filesystem::remove(task.path, error);
+            }
+            break;
+        case Task::Type::Remove:
+            // the tasks run in order, so the segment is already compressed if it should be
+            std::filesystem::remove(task.path, error);
+            std::filesystem::remove(compressedPath(task.path), error);
+            break;
+        }
+        lock.lock();
+    }
+}
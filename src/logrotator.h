@@ -0,0 +1,88 @@
+/*
+    VSD prints debugging messages of applications and their
+    sub-processes to console and supports logging of their output.
+    Copyright (C) 2026  Hannah von Reth <vonreth@kde.org>
+
+
+    VSD is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    VSD is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with VSD.  If not, see <http://www.gnu.org/licenses/>.
+    */
+
+
+#ifndef LOGROTATOR_H
+#define LOGROTATOR_H
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <mutex>
+#include <thread>
+
+// Names the segments of a rotated log and compresses and removes the closed ones on a background thread.
+// Without rotation the log is written to the path it was given, otherwise to numbered segments next to it,
+// vsd.html becomes vsd.1.html, vsd.2.html, ...
+class LogRotator
+{
+public:
+    struct Policy
+    {
+        // start a new segment once the current one reached this size, 0 disables it
+        uint64_t maxSize = 0;
+        // start a new segment after this time, 0 disables it
+        std::chrono::minutes interval { 0 };
+        // the number of segments that are kept, including the current one
+        size_t keep = 5;
+        // gzip the closed segments
+        bool compress = true;
+
+        inline bool enabled() const
+        {
+            return maxSize > 0 || interval.count() > 0;
+        }
+    };
+
+    LogRotator(const std::filesystem::path &path, const Policy &policy);
+    // finishes the pending compressions
+    ~LogRotator();
+
+    const std::filesystem::path &currentPath() const;
+    bool shouldRotate(uint64_t segmentSize) const;
+    // must be called after the current segment was closed, returns the path of the next one
+    const std::filesystem::path &next();
+
+private:
+    std::filesystem::path segmentPath(uint64_t index) const;
+    void run();
+
+    const std::filesystem::path m_path;
+    const Policy m_policy;
+    uint64_t m_index = 1;
+    std::filesystem::path m_current;
+    std::chrono::steady_clock::time_point m_segmentStart;
+
+    struct Task
+    {
+        enum class Type { Compress, Remove };
+        Type type;
+        std::filesystem::path path;
+    };
+    std::mutex m_mutex;
+    std::condition_variable m_wakeUp;
+    std::deque<Task> m_tasks;
+    bool m_stop = false;
+    std::thread m_thread;
+};
+
+#endif // LOGROTATOR_H
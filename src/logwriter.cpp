@@ -0,0 +1,39 @@
+/*
+    VSD prints debugging messages of applications and their
+    sub-processes to console and supports logging of their output.
+    Copyright (C) 2026  Hannah von Reth <vonreth@kde.org>
+
+
+    VSD is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    VSD is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with VSD.  If not, see <http://www.gnu.org/licenses/>.
+    */
+
+
+#include "logwriter.h"
+
+#include "asyncfilewriter.h"
+#include "bufferedfilewriter.h"
+#include "mappedfilewriter.h"
+
+std::unique_ptr<LogWriter> LogWriter::create(Type type, const std::filesystem::path &path, const FlushPolicy &policy)
+{
+    switch (type) {
+    case Type::Async:
+        return std::make_unique<AsyncFileWriter>(path, policy);
+    case Type::Mapped:
+        return std::make_unique<MappedFileWriter>(path);
+    case Type::Buffered:
+        return std::make_unique<BufferedFileWriter>(path, policy);
+    }
+    return {};
+}
@@ -0,0 +1,63 @@
+/*
+    VSD prints debugging messages of applications and their
+    sub-processes to console and supports logging of their output.
+    Copyright (C) 2026  Hannah von Reth <vonreth@kde.org>
+
+
+    VSD is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    VSD is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with VSD.  If not, see <http://www.gnu.org/licenses/>.
+    */
+
+
+#ifndef LOGWRITER_H
+#define LOGWRITER_H
+
+#include <chrono>
+#include <filesystem>
+#include <memory>
+#include <string_view>
+
+// Writes utf-8 text to a log file
+class LogWriter
+{
+public:
+    enum class Type {
+        // a background thread writes a double buffer
+        Async,
+        // the file is preallocated and mapped
+        Mapped,
+        // the calling thread writes a small buffer
+        Buffered
+    };
+
+    struct FlushPolicy
+    {
+        // longest time data stays in memory
+        std::chrono::milliseconds interval { 1000 };
+        // amount of buffered data that triggers a write before the interval elapsed
+        size_t size = 1024 * 1024;
+        // write as soon as possible after something was written to stderr
+        bool onError = true;
+    };
+
+    static std::unique_ptr<LogWriter> create(Type type, const std::filesystem::path &path, const FlushPolicy &policy);
+
+    virtual ~LogWriter() = default;
+
+    virtual bool isOpen() const = 0;
+    virtual void write(std::string_view data) = 0;
+    // makes the data written so far visible to other readers of the file without waiting for the disk
+    virtual void flush() = 0;
+};
+
+#endif // LOGWRITER_H
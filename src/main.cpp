@@ -22,6 +22,11 @@
 #include "libvsd/vsdchildprocess.h"
 #include "libvsd/utils.h"
 
+#include "capture.h"
+#include "jsonlineswriter.h"
+#include "logrotator.h"
+#include "logwriter.h"
+
 #include "3dparty/nlohmann/json.hpp"
 
 #include <windows.h>
@@ -34,51 +39,101 @@
 #include <signal.h>
 #include <mutex>
 #include <chrono>
-#include <regex>
 #include <clocale>
 #include <filesystem>
+#include <optional>
+#include <memory>
+#include <unordered_map>
 
 #include <iostream>
 #include <io.h>
 #include <ios>
 #include <fcntl.h>
-#include <codecvt>
+
+#ifndef ENABLE_VIRTUAL_TERMINAL_PROCESSING
+#define ENABLE_VIRTUAL_TERMINAL_PROCESSING 0x0004
+#endif
 
 namespace {
-constexpr bool iseol(wchar_t c)
+constexpr bool iseol(char c)
 {
-    return c == L'\n' || c == L'\r';
+    return c == '\n' || c == '\r';
 }
 
-inline std::wstring rtrim(std::wstring s)
+inline std::string_view rtrim(std::string_view s)
 {
-    s.erase(std::find_if(s.rbegin(), s.rend(), [](int ch) {
-        return !iseol(ch);
-    }).base(),
-        s.end());
+    while (!s.empty() && iseol(s.back())) {
+        s.remove_suffix(1);
+    }
     return s;
 }
 
+std::optional<libvsd::VSDProcess::BackpressurePolicy> parseBackpressure(const std::string &policy)
+{
+    if (policy == "block") {
+        return libvsd::VSDProcess::BackpressurePolicy::Block;
+    } else if (policy == "drop-oldest") {
+        return libvsd::VSDProcess::BackpressurePolicy::DropOldest;
+    } else if (policy == "drop-newest") {
+        return libvsd::VSDProcess::BackpressurePolicy::DropNewest;
+    } else if (policy == "sample") {
+        return libvsd::VSDProcess::BackpressurePolicy::Sample;
+    }
+    return {};
+}
+
+std::optional<LogWriter::Type> parseLogWriter(const std::string &writer)
+{
+    if (writer == "async") {
+        return LogWriter::Type::Async;
+    } else if (writer == "mapped") {
+        return LogWriter::Type::Mapped;
+    }
+    return {};
+}
+
 std::filesystem::path configPath()
 {
     std::filesystem::path path(Utils::getModuleName(GetCurrentProcess(), nullptr));
     return path.parent_path() / L"vsd.conf";
 }
 
+nlohmann::json readConfig()
+{
+    nlohmann::json config = nlohmann::json::parse("{}");
+    const std::filesystem::path confFile = configPath();
+    if (std::filesystem::exists(confFile)) {
+        std::ifstream stream(confFile);
+        stream >> config;
+    }
+    return config;
+}
+
 class ColorStream
 {
 public:
     enum class Color { None, Red, Green, Blue };
 
-    ColorStream() = default;
-    virtual ~ColorStream() {};
-    virtual ColorStream &setColor(Color color) = 0;
-    virtual ColorStream &operator<<(const std::wstring_view &) = 0;
-
-    ColorStream &operator<<(int i)
+    // a formatted message, shared by all streams
+    struct Record
     {
-        return *this << std::to_wstring(i);
+        Color color = Color::None;
+        // utf-8
+        std::string_view text;
+        // relative to the start of vsd or of the capture
+        std::chrono::microseconds time { 0 };
+        // the name of the process, empty for stdout, stderr and the messages of vsd
+        std::string_view process;
+        // stderr output or a process that stopped with an error
+        bool error = false;
     };
+
+    ColorStream() = default;
+    virtual ~ColorStream() {};
+    // each stream renders a record only once
+    virtual void write(const Record &record) = 0;
+    // called after each batch of events
+    virtual void flush() {};
 };
 
 class ColorGroupoStream : public ColorStream
@@ -92,25 +147,28 @@ public:
         m_streams.clear();
     }
 
-    ColorStream &setColor(ColorGroupoStream::Color color) override
+    void addStream(ColorStream *stream)
     {
-        for (const auto str : m_streams) {
-            str->setColor(color);
-        }
-        return *this;
+        m_streams.push_back(stream);
     }
 
-    void addStream(ColorStream *stream)
+    bool isEmpty() const
     {
-        m_streams.push_back(stream);
+        return m_streams.empty();
+    }
+
+    void write(const Record &record) override
+    {
+        for (const auto str : m_streams) {
+            str->write(record);
+        }
     }
 
-    ColorStream &operator<<(const std::wstring_view &x) override
+    void flush() override
     {
         for (const auto str : m_streams) {
-            *str << x;
+            str->flush();
         }
-        return *this;
     }
 
 private:
@@ -123,17 +181,81 @@ public:
     ColorOutStream(HANDLE hout)
         : m_hout(hout)
     {
-        GetConsoleScreenBufferInfo(m_hout, &m_consoleSettings);
+        m_isConsole = GetConsoleMode(m_hout, &m_consoleMode);
+        if (m_isConsole) {
+            GetConsoleScreenBufferInfo(m_hout, &m_consoleSettings);
+            m_useVt = SetConsoleMode(m_hout, m_consoleMode | ENABLE_VIRTUAL_TERMINAL_PROCESSING);
+        }
+        m_buffer.reserve(FlushSize);
     }
 
     ~ColorOutStream()
     {
-        SetConsoleTextAttribute(m_hout, m_consoleSettings.wAttributes);
+        setColor(ColorStream::Color::None);
+        flush();
+        if (m_useVt) {
+            SetConsoleMode(m_hout, m_consoleMode);
+        }
         CloseHandle(m_hout);
     }
-    virtual ColorStream &setColor(ColorGroupoStream::Color color) override
+
+    void write(const Record &record) override
     {
-        int colorAttribute = 0;
+        setColor(record.color);
+        m_buffer += record.text;
+        if (m_buffer.size() >= FlushSize) {
+            flush();
+        }
+    }
+
+    void flush() override
+    {
+        if (m_buffer.empty()) {
+            return;
+        }
+        DWORD written;
+        if (m_isConsole) {
+            // the console is the only sink that needs utf-16
+            Utils::utf8ToUtf16(m_buffer, m_wide);
+            WriteConsoleW(m_hout, m_wide.data(), static_cast<DWORD>(m_wide.size()), &written, nullptr);
+        } else {
+            WriteFile(m_hout, m_buffer.data(), static_cast<DWORD>(m_buffer.size()), &written, nullptr);
+        }
+        m_buffer.clear();
+    }
+
+private:
+    // a batch larger than this is written in several parts
+    static constexpr size_t FlushSize = 64 * 1024;
+
+    void setColor(ColorStream::Color color)
+    {
+        // colors are only used on a console, redirected output stays plain
+        if (!m_isConsole || color == m_color) {
+            return;
+        }
+        m_color = color;
+        if (m_useVt) {
+            switch (color) {
+            case ColorStream::Color::None:
+                m_buffer += "\x1b[0m";
+                break;
+            case ColorStream::Color::Red:
+                m_buffer += "\x1b[91m";
+                break;
+            case ColorStream::Color::Blue:
+                m_buffer += "\x1b[94m";
+                break;
+            case ColorStream::Color::Green:
+                m_buffer += "\x1b[92m";
+                break;
+            }
+            return;
+        }
+
+        // consoles without vt support need the text written before the color changes
+        flush();
+        WORD colorAttribute = 0;
         switch (color) {
         case ColorStream::Color::None:
             colorAttribute = m_consoleSettings.wAttributes;
@@ -149,103 +271,427 @@ public:
             break;
         }
         SetConsoleTextAttribute(m_hout, colorAttribute);
-        return *this;
-    };
-
-    ColorStream &operator<<(const std::wstring_view &x) override
-    {
-        std::wcout << x;
-        return *this;
     }
 
-private:
     HANDLE m_hout;
+    bool m_isConsole = false;
+    bool m_useVt = false;
+    DWORD m_consoleMode = 0;
     CONSOLE_SCREEN_BUFFER_INFO m_consoleSettings;
+    ColorStream::Color m_color = ColorStream::Color::None;
+    std::string m_buffer;
+    std::wstring m_wide;
 };
 
+// hours:minutes:seconds:milliseconds
+std::string formatDuration(const std::chrono::high_resolution_clock::duration &time)
+{
+    std::stringstream out;
+    out << std::chrono::duration_cast<std::chrono::hours>(time).count() << ":"
+        << std::chrono::duration_cast<std::chrono::minutes>(time).count() % 60 << ":"
+        << std::chrono::duration_cast<std::chrono::seconds>(time).count() % 60 << ":"
+        << std::chrono::duration_cast<std::chrono::milliseconds>(time).count() % 1000;
+    return out.str();
+}
 
 class SimpleFileStream : public ColorStream
 {
 public:
-    SimpleFileStream(const std::filesystem::path &name)
+    SimpleFileStream(const std::filesystem::path &name, LogWriter::Type type, const LogWriter::FlushPolicy &policy, const LogRotator::Policy &rotation)
+        : m_type(type)
+        , m_policy(policy)
+        , m_rotator(name, rotation)
+        , m_out(LogWriter::create(type, m_rotator.currentPath(), policy))
     {
-        m_out.open(name, std::ios::out | std::ios::binary);
-        // unsigned char utf8BOM[] = {0xEF,0xBB,0xBF};
-        // m_out.write((wchar_t*)utf8BOM,sizeof(utf8BOM)/2);
-#pragma warning(disable : 4996)
-        const std::locale utf8_locale = std::locale(std::locale(),
-            new std::codecvt_utf8_utf16<wchar_t, 0x10ffff, std::codecvt_mode(std::consume_header | std::generate_header)>);
-#pragma warning(default : 4996)
-        m_out.imbue(utf8_locale);
     }
-    virtual ~SimpleFileStream()
+
+    void write(const Record &record) override
     {
-        m_out.close();
+        writeSegment(record.text);
+        m_errorWritten |= record.error;
     }
 
-    virtual ColorStream &setColor(ColorStream::Color) override { return *this; };
-
-    ColorStream &operator<<(const std::wstring_view &x) override
+    void flush() override
     {
-        m_out << x;
-        return *this;
+        // everything else is written by the writer thread once the interval or size is reached
+        if (m_errorWritten && m_policy.onError) {
+            m_out->flush();
+        }
+        m_errorWritten = false;
+        // only between batches, so a segment never ends in the middle of a line
+        if (m_rotator.shouldRotate(m_segmentSize)) {
+            rotate();
+        }
     }
 
 protected:
-    std::wofstream m_out;
+    virtual void rotate()
+    {
+        writeFooter();
+        m_out.reset();
+        m_out = LogWriter::create(m_type, m_rotator.next(), m_policy);
+        m_segmentSize = 0;
+        writeHeader();
+    }
+
+    // everything written counts towards the size of the segment, not only the records
+    void writeSegment(std::string_view data)
+    {
+        m_out->write(data);
+        m_segmentSize += data.size();
+    }
+
+    // each segment of a rotated log is a complete document
+    virtual void writeHeader() {};
+    virtual void writeFooter() {};
+
+    const LogWriter::Type m_type;
+    const LogWriter::FlushPolicy m_policy;
+    LogRotator m_rotator;
+    std::unique_ptr<LogWriter> m_out;
+    uint64_t m_segmentSize = 0;
+    bool m_errorWritten = false;
 };
 
 class ColorFileStream : public SimpleFileStream
 {
 public:
-    ColorFileStream(const std::filesystem::path &name, const std::wstring &program, const std::wstring &arguments)
-        : SimpleFileStream(name)
-    {
-        m_out << "<!DOCTYPE html>\n"
-              << "<html>\n"
-              << "<head>\n"
-              << "<meta charset=\"UTF-8\" />\n"
-              << "<title>VSD " << program << " " << arguments << "</title>\n"
-              << "</head>\n"
-              << "<body>"
-              << "<p style=\"color:blue\">";
+    ColorFileStream(const std::filesystem::path &name, LogWriter::Type type, const LogWriter::FlushPolicy &policy, const LogRotator::Policy &rotation,
+                    const std::wstring &program, const std::wstring &arguments)
+        : SimpleFileStream(name, type, policy, rotation)
+    {
+        Utils::appendEscapedHtml(Utils::wideCharToMultiByte(program) + " " + Utils::wideCharToMultiByte(arguments), m_title);
+        writeHeader();
     }
     ~ColorFileStream()
     {
-        m_out << "</body>\n\n</html>\n";
+        writeFooter();
     }
 
-    virtual ColorStream &setColor(ColorStream::Color color) override
+    void write(const Record &record) override
     {
-        m_out << "</p><p style=\"color:";
-        switch (color) {
+        // consecutive records of the same color share a paragraph
+        if (record.color != m_color) {
+            m_color = record.color;
+            writeSegment("</p>");
+            writeParagraph();
+        }
+        m_buffer.clear();
+        Utils::appendEscapedHtml(record.text, m_buffer);
+        Record escaped = record;
+        escaped.text = m_buffer;
+        SimpleFileStream::write(escaped);
+    }
+
+protected:
+    // escaped
+    std::string m_title;
+
+    void writeHeader() override
+    {
+        writeSegment("<!DOCTYPE html>\n"
+                     "<html>\n"
+                     "<head>\n"
+                     "<meta charset=\"UTF-8\" />\n"
+                     "<title>VSD ");
+        writeSegment(m_title);
+        writeSegment("</title>\n"
+                     "<style>\n"
+                     "p{margin:0}.n{color:black}.r{color:red}.g{color:green}.b{color:blue}\n"
+                     "</style>\n"
+                     "</head>\n"
+                     "<body>");
+        writeParagraph();
+    }
+
+    void writeFooter() override
+    {
+        writeSegment("</p></body>\n\n</html>\n");
+    }
+
+private:
+    void writeParagraph()
+    {
+        switch (m_color) {
         case ColorStream::Color::Blue:
-            m_out << "blue";
+            writeSegment("<p class=b>");
             break;
         case ColorStream::Color::Green:
-            m_out << "green";
+            writeSegment("<p class=g>");
             break;
         case ColorStream::Color::Red:
-            m_out << "red";
+            writeSegment("<p class=r>");
             break;
-        default:
-            m_out << "black";
+        case ColorStream::Color::None:
+            writeSegment("<p class=n>");
+            break;
+        }
+    }
+
+    ColorStream::Color m_color = ColorStream::Color::Blue;
+    // reused between writes so escaping doesn't allocate per message
+    std::string m_buffer;
+};
+
+// Splits the html log into pages of a fixed size and writes an index page to the path of the log,
+// listing the time range, the processes and the number of errors of each page
+class PagedHtmlStream : public ColorFileStream
+{
+public:
+    PagedHtmlStream(const std::filesystem::path &name, LogWriter::Type type, const LogWriter::FlushPolicy &policy, uint64_t pageSize,
+                    const std::wstring &program, const std::wstring &arguments)
+        : ColorFileStream(name, type, policy, pagePolicy(pageSize), program, arguments)
+        , m_indexPath(name)
+    {
+        addPage();
+    }
+
+    ~PagedHtmlStream()
+    {
+        writeIndex();
+    }
+
+    void write(const Record &record) override
+    {
+        Page &page = m_pages.back();
+        if (page.events++ == 0) {
+            page.begin = record.time;
+        }
+        page.end = record.time;
+        if (!record.process.empty() && (page.processes.empty() || page.processes.back() != record.process)
+            && std::find(page.processes.begin(), page.processes.end(), record.process) == page.processes.end()) {
+            page.processes.emplace_back(record.process);
+        }
+        if (record.error) {
+            if (page.errors++ == 0) {
+                // the target of the links in the index
+                writeSegment("<a id=err></a>");
+            }
         }
-        m_out << "\">";
-        return *this;
+        ColorFileStream::write(record);
+    }
+
+protected:
+    void rotate() override
+    {
+        ColorFileStream::rotate();
+        addPage();
+    }
+
+private:
+    struct Page
+    {
+        // escaped for the links
+        std::string file;
+        uint64_t events = 0;
+        uint64_t errors = 0;
+        std::chrono::microseconds begin { 0 };
+        std::chrono::microseconds end { 0 };
+        std::vector<std::string> processes;
     };
 
-    ColorStream &operator<<(const std::wstring_view &x) override
+    static LogRotator::Policy pagePolicy(uint64_t pageSize)
     {
-        static std::wregex regex(L"[\\r|\\r\\n]");
-        m_out << std::regex_replace(x.data(), regex, L"</br>");
-        return *this;
+        LogRotator::Policy policy;
+        policy.maxSize = pageSize;
+        policy.keep = SIZE_MAX;
+        policy.compress = false;
+        return policy;
     }
+
+    void addPage()
+    {
+        m_pages.emplace_back();
+        Utils::appendEscapedHtml(Utils::wideCharToMultiByte(m_rotator.currentPath().filename().wstring()), m_pages.back().file);
+        writeIndex();
+    }
+
+    // rewritten whenever a page is started, so the log can be browsed while vsd is running
+    void writeIndex()
+    {
+        std::string out;
+        out += "<!DOCTYPE html>\n"
+               "<html>\n"
+               "<head>\n"
+               "<meta charset=\"UTF-8\" />\n"
+               "<title>VSD ";
+        out += m_title;
+        out += "</title>\n"
+               "<style>\n"
+               "table{border-collapse:collapse}td,th{border:1px solid gray;padding:2px 8px;text-align:left}.r{color:red}\n"
+               "</style>\n"
+               "</head>\n"
+               "<body><h3>VSD ";
+        out += m_title;
+        out += "</h3>\n";
+        const auto firstError = std::find_if(m_pages.begin(), m_pages.end(), [](const Page &page) { return page.errors > 0; });
+        if (firstError != m_pages.end()) {
+            out += "<p><a class=r href=\"" + firstError->file + "#err\">Jump to the first error</a></p>\n";
+        }
+        out += "<table>\n<tr><th>Page</th><th>Time</th><th>Processes</th><th>Errors</th></tr>\n";
+        for (size_t i = 0; i < m_pages.size(); ++i) {
+            const Page &page = m_pages[i];
+            const std::string number = std::to_string(i + 1);
+            out += "<tr><td><a href=\"" + page.file + "\">" + number + "</a></td><td>";
+            if (page.events > 0) {
+                out += formatDuration(page.begin) + " - " + formatDuration(page.end);
+            }
+            out += "</td><td>";
+            for (size_t p = 0; p < page.processes.size(); ++p) {
+                if (p > 0) {
+                    out += ", ";
+                }
+                Utils::appendEscapedHtml(page.processes[p], out);
+            }
+            out += "</td><td>";
+            if (page.errors > 0) {
+                out += "<a class=r href=\"" + page.file + "#err\">" + std::to_string(page.errors) + "</a>";
+            } else {
+                out += std::to_string(page.errors);
+            }
+            out += "</td></tr>\n";
+        }
+        out += "</table>\n</body>\n\n</html>\n";
+        std::ofstream(m_indexPath, std::ios::out | std::ios::binary | std::ios::trunc).write(out.data(), out.size());
+    }
+
+    const std::filesystem::path m_indexPath;
+    std::vector<Page> m_pages;
 };
+
+// the formatting shared by the live output and the rendering of a capture, the text is appended to out
+void formatDebug(std::string &out, std::string_view prefix, std::string_view data)
+{
+    out += prefix;
+    out += rtrim(data);
+    out += '\n';
+}
+
+void formatDllLoad(std::string &out, std::string_view prefix, std::string_view data, bool loading)
+{
+    out += prefix;
+    out += loading ? "Loading: " : "Unloading: ";
+    out += data;
+    out += '\n';
+}
+
+void formatProcessStarted(std::string &out, std::string_view path, std::string_view arguments, unsigned long pid)
+{
+    out += "Process Created: ";
+    out += path;
+    out += " [";
+    out += arguments;
+    out += "] (";
+    out += std::to_string(pid);
+    out += ")\n";
+}
+
+void formatProcessStopped(std::string &out, std::string_view path, unsigned long pid, std::string_view error, uint32_t exitCode,
+                          const std::chrono::high_resolution_clock::duration &time)
+{
+    out += "Process Stopped: ";
+    out += path;
+    out += " (";
+    out += std::to_string(pid);
+    out += ")";
+    if (!error.empty()) {
+        out += " Error: ";
+        out += error;
+    }
+    std::stringstream code;
+    code << std::hex << std::showbase << exitCode << std::dec;
+    out += " With exit Code: ";
+    out += code.str();
+    out += " After: ";
+    out += formatDuration(time);
+    out += '\n';
+}
 }
 
 using namespace libvsd;
 
+// Writes the messages of each process to its own file in a directory and keeps an index of the processes.
+// stdout and stderr are shared by all processes, they are written to output.log.
+class ProcessLogs
+{
+public:
+    ProcessLogs(const std::filesystem::path &dir, LogWriter::Type type, const LogWriter::FlushPolicy &policy)
+        : m_dir(dir)
+        , m_type(type)
+        , m_policy(policy)
+    {
+        std::error_code error;
+        std::filesystem::create_directories(m_dir, error);
+        m_index = LogWriter::create(m_type, m_dir / L"index.log", m_policy);
+        m_output = std::make_unique<SimpleFileStream>(m_dir / L"output.log", m_type, m_policy, LogRotator::Policy());
+    }
+
+    bool isOpen() const
+    {
+        return m_index->isOpen();
+    }
+
+    // the record is the formatted event, it is routed by the pid of the event
+    void write(const VSDEvent &event, const ColorStream::Record &record)
+    {
+        switch (event.type) {
+        case VSDEvent::Type::Stdout:
+        case VSDEvent::Type::Stderr:
+            m_output->write(record);
+            break;
+        case VSDEvent::Type::Debug:
+        case VSDEvent::Type::DllLoad:
+        case VSDEvent::Type::DllUnload:
+            stream(event).write(record);
+            break;
+        case VSDEvent::Type::ProcessStarted:
+            stream(event).write(record);
+            m_index->write(formatDuration(record.time) + " Started: " + Utils::wideCharToMultiByte(fileName(event).wstring()) + " "
+                           + Utils::wideCharToMultiByte(event.process->path().wstring()) + "\n");
+            break;
+        case VSDEvent::Type::ProcessStopped: {
+            stream(event).write(record);
+            std::stringstream exitCode;
+            exitCode << std::hex << std::showbase << event.process->exitCode();
+            m_index->write(formatDuration(record.time) + " Stopped: " + Utils::wideCharToMultiByte(fileName(event).wstring())
+                           + " With exit Code: " + exitCode.str() + "\n");
+            // don't keep the handles of stopped processes
+            m_streams.erase(event.pid);
+            break;
+        }
+        }
+    }
+
+    void flush()
+    {
+        m_output->flush();
+    }
+
+private:
+    std::filesystem::path fileName(const VSDEvent &event) const
+    {
+        return event.process->name() + L"-" + std::to_wstring(event.pid) + L".log";
+    }
+
+    // opened with the first event of the process, there might be hundreds of them,
+    // so they are written without a thread and a large buffer of their own
+    ColorStream &stream(const VSDEvent &event)
+    {
+        auto it = m_streams.find(event.pid);
+        if (it == m_streams.end()) {
+            it = m_streams.emplace(event.pid, std::make_unique<SimpleFileStream>(m_dir / fileName(event), LogWriter::Type::Buffered, m_policy, LogRotator::Policy())).first;
+        }
+        return *it->second;
+    }
+
+    const std::filesystem::path m_dir;
+    const LogWriter::Type m_type;
+    const LogWriter::FlushPolicy m_policy;
+    std::unique_ptr<LogWriter> m_index;
+    std::unique_ptr<SimpleFileStream> m_output;
+    std::unordered_map<unsigned long, std::unique_ptr<SimpleFileStream>> m_streams;
+};
+
 void printHelp()
 {
     std::wcout << L"Usage: vsd TARGET_APPLICATION [ARGUMENTS] [OPTIONS]" << std::endl
@@ -253,12 +699,26 @@ void printHelp()
                << L"--vsd-separate-error \t\t Separate stderr and stdout to identify stderr messages" << std::endl
                << L"--vsd-log logFile \t\t Write the logFile in colored html" << std::endl
                << L"--vsd-log-plain logFile \t Write a log plaintext to logFile" << std::endl
+               << L"--vsd-log-paged logFile \t Write the html log in pages and an index of the pages to logFile" << std::endl
+               << L"--vsd-log-page-size KiB\t The size of a page of the paged html log" << std::endl
+               << L"--vsd-log-per-process dir\t Write the messages of each process to its own file in dir" << std::endl
+               << L"--vsd-log-jsonl logFile \t Write one json object per event to logFile" << std::endl
+               << L"--vsd-log-writer writer\t How the log is written: async or mapped, a preallocated memory mapped file" << std::endl
+               << L"--vsd-log-rotate-size MiB\t Start a new log segment once the current one reached this size" << std::endl
+               << L"--vsd-log-rotate-interval min\t Start a new log segment after this many minutes" << std::endl
+               << L"--vsd-log-keep N\t\t The number of log segments to keep, closed segments are compressed" << std::endl
+               << L"--vsd-capture file.vsdc \t Write a compact binary capture, which can be rendered later with --render" << std::endl
                << L"--vsd-all\t\t\t Debug also all processes created by TARGET_APPLICATION" << std::endl
                << L"--vsd-debug-dll\t\t\t Debugg dll loading" << std::endl
                << L"--vsd-log-dll\t\t\t Log dll loading" << std::endl
                << L"--vsd-no-console\t\t Don't log to console" << std::endl
+               << L"--vsd-backpressure policy\t What to do if the output can't keep up: block, drop-oldest, drop-newest or sample" << std::endl
+               << L"--vsd-max-queue MiB\t\t Memory limit for the messages waiting for the output" << std::endl
                << L"--help \t\t\t\t Print this help" << std::endl
-               << L"--version\t\t\t Print version and copyright information" << std::endl;
+               << L"--version\t\t\t Print version and copyright information" << std::endl
+               << std::endl
+               << L"Usage: vsd --render file.vsdc [--vsd-log logFile | --vsd-log-plain logFile | --vsd-log-paged logFile] [--vsd-log-page-size KiB] [--vsd-log-dll] [--vsd-no-console]" << std::endl
+               << L"Renders a capture like it would have been printed or logged during the run" << std::endl;
     exit(0);
 }
 
@@ -282,20 +742,31 @@ public:
     {
         std::wstring program(in[1]);
         std::wstringstream arguments;
-        nlohmann::json config = nlohmann::json::parse("{}");
-
-        const std::filesystem::path confFile = configPath();
-        if (std::filesystem::exists(confFile)) {
-            std::ifstream stream(confFile);
-            stream >> config;
-        }
+        const nlohmann::json config = readConfig();
         bool debug_dll = config.value("debugDllLoading", false);
         m_logDll = config.value("logDllLoading", false);
         bool withSubProcess = config.value("attachSubprocess", false);
 
         std::filesystem::path logFile;
+        std::filesystem::path captureFile;
+        std::filesystem::path jsonLinesFile;
+        std::filesystem::path processLogDir;
         bool htmlLog = config.value("logHtml", true);
+        bool pagedLog = false;
+        uint64_t pageSize = config.value("logPageKiB", uint64_t(4096)) * 1024;
         m_channels = config.value("mergeChannels", true) ? VSDProcess::ProcessChannelMode::MergedChannels : VSDProcess::ProcessChannelMode::SeperateChannels;
+        auto backpressure = parseBackpressure(config.value("backpressure", std::string("block")));
+        size_t maxQueueMiB = config.value("maxQueueMiB", 64);
+        auto logWriter = parseLogWriter(config.value("logWriter", std::string("async")));
+        LogWriter::FlushPolicy flushPolicy;
+        flushPolicy.interval = std::chrono::milliseconds(config.value("logFlushIntervalMs", flushPolicy.interval.count()));
+        flushPolicy.size = config.value("logFlushKiB", flushPolicy.size / 1024) * 1024;
+        flushPolicy.onError = config.value("logFlushOnError", flushPolicy.onError);
+        LogRotator::Policy rotation;
+        rotation.maxSize = config.value("logRotateMiB", uint64_t(0)) * 1024 * 1024;
+        rotation.interval = std::chrono::minutes(config.value("logRotateMinutes", rotation.interval.count()));
+        rotation.keep = config.value("logRotateKeep", rotation.keep);
+        rotation.compress = config.value("logCompress", rotation.compress);
 
 
         for (int i = 1; i < len; ++i) {
@@ -313,6 +784,14 @@ public:
                 } else {
                     printHelp();
                 }
+            } else if (arg == L"--vsd-log-paged") {
+                htmlLog = true;
+                pagedLog = true;
+                if (i + 1 < len) {
+                    logFile = in[++i];
+                } else {
+                    printHelp();
+                }
             } else if (arg == L"--vsd-log-plain") {
                 htmlLog = false;
                 if (i + 1 < len) {
@@ -320,10 +799,70 @@ public:
                 } else {
                     printHelp();
                 }
+            } else if (arg == L"--vsd-log-writer") {
+                if (i + 1 < len) {
+                    logWriter = parseLogWriter(Utils::wideCharToMultiByte(in[++i]));
+                } else {
+                    printHelp();
+                }
+            } else if (arg == L"--vsd-log-rotate-size") {
+                if (i + 1 < len) {
+                    rotation.maxSize = std::wcstoull(in[++i], nullptr, 10) * 1024 * 1024;
+                } else {
+                    printHelp();
+                }
+            } else if (arg == L"--vsd-log-rotate-interval") {
+                if (i + 1 < len) {
+                    rotation.interval = std::chrono::minutes(std::wcstoul(in[++i], nullptr, 10));
+                } else {
+                    printHelp();
+                }
+            } else if (arg == L"--vsd-log-keep") {
+                if (i + 1 < len) {
+                    rotation.keep = std::wcstoul(in[++i], nullptr, 10);
+                } else {
+                    printHelp();
+                }
+            } else if (arg == L"--vsd-log-per-process") {
+                if (i + 1 < len) {
+                    processLogDir = in[++i];
+                } else {
+                    printHelp();
+                }
+            } else if (arg == L"--vsd-log-jsonl") {
+                if (i + 1 < len) {
+                    jsonLinesFile = in[++i];
+                } else {
+                    printHelp();
+                }
+            } else if (arg == L"--vsd-capture") {
+                if (i + 1 < len) {
+                    captureFile = in[++i];
+                } else {
+                    printHelp();
+                }
             } else if (arg == L"--vsd-all") {
                 withSubProcess = true;
             } else if (arg == L"--vsd-no-console") {
                 m_noOutput = true;
+            } else if (arg == L"--vsd-backpressure") {
+                if (i + 1 < len) {
+                    backpressure = parseBackpressure(Utils::wideCharToMultiByte(in[++i]));
+                } else {
+                    printHelp();
+                }
+            } else if (arg == L"--vsd-max-queue") {
+                if (i + 1 < len) {
+                    maxQueueMiB = std::wcstoul(in[++i], nullptr, 10);
+                } else {
+                    printHelp();
+                }
+            } else if (arg == L"--vsd-log-page-size") {
+                if (i + 1 < len) {
+                    pageSize = std::wcstoull(in[++i], nullptr, 10) * 1024;
+                } else {
+                    printHelp();
+                }
             } else if (i == 1) {
                 if (arg == L"--help") {
                     printHelp();
@@ -340,18 +879,50 @@ public:
             m_out.addStream(new ColorOutStream(hout));
         }
 
+        if (!logWriter || rotation.keep == 0 || pageSize == 0) {
+            printHelp();
+        }
         if (!logFile.empty()) {
-            if (htmlLog) {
-                m_out.addStream(new ColorFileStream(logFile, program, arguments.str()));
+            if (pagedLog) {
+                m_out.addStream(new PagedHtmlStream(logFile, *logWriter, flushPolicy, pageSize, program, arguments.str()));
+            } else if (htmlLog) {
+                m_out.addStream(new ColorFileStream(logFile, *logWriter, flushPolicy, rotation, program, arguments.str()));
             } else {
-                m_out.addStream(new SimpleFileStream(logFile));
+                m_out.addStream(new SimpleFileStream(logFile, *logWriter, flushPolicy, rotation));
+            }
+        }
+        if (!captureFile.empty()) {
+            m_capture = std::make_unique<Capture::Writer>(captureFile, flushPolicy, Utils::wideCharToMultiByte(program),
+                                                          Utils::wideCharToMultiByte(arguments.str()));
+            if (!m_capture->isOpen()) {
+                std::wcerr << L"Failed to open " << captureFile.wstring() << std::endl;
+                exit(1);
             }
         }
-        m_out.setColor(ColorStream::Color::Blue) << program << L" " << arguments.str() << L"\n";
+        if (!processLogDir.empty()) {
+            m_processLogs = std::make_unique<ProcessLogs>(processLogDir, *logWriter, flushPolicy);
+            if (!m_processLogs->isOpen()) {
+                std::wcerr << L"Failed to open " << processLogDir.wstring() << std::endl;
+                exit(1);
+            }
+        }
+        if (!jsonLinesFile.empty()) {
+            m_jsonLines = std::make_unique<JsonLinesWriter>(jsonLinesFile, *logWriter, flushPolicy);
+            if (!m_jsonLines->isOpen()) {
+                std::wcerr << L"Failed to open " << jsonLinesFile.wstring() << std::endl;
+                exit(1);
+            }
+        }
+        writeDirect(ColorStream::Color::Blue, Utils::wideCharToMultiByte(program + L" " + arguments.str() + L"\n"));
+        m_out.flush();
 
         m_process = new VSDProcess(program, arguments.str(), this);
         m_process->debugDllLoading(debug_dll);
         m_process->debugSubProcess(withSubProcess);
+        if (!backpressure || maxQueueMiB == 0) {
+            printHelp();
+        }
+        m_process->setBackpressure(*backpressure, maxQueueMiB * 1024 * 1024);
     }
 
     ~VSDImp() { delete m_process; }
@@ -360,74 +931,297 @@ public:
     inline void run()
     {
         m_exitCode = m_process->run(m_channels);
-        writeStdout(L"\n");
+        if (m_process->droppedRecords() > 0) {
+            writeDirect(ColorStream::Color::Red,
+                        "Dropped " + std::to_string(m_process->droppedRecords()) + " messages (" + std::to_string(m_process->droppedBytes())
+                            + " bytes) because the output could not keep up\n");
+        }
+        // only worth mentioning if several processes loaded the same modules
+        if (m_process->modulePathCacheHits() > 0) {
+            writeDirect(ColorStream::Color::Blue,
+                        "Module paths: " + std::to_string(m_process->modulePathLookups()) + " lookups, "
+                            + std::to_string(m_process->modulePathCacheHits() * 100 / m_process->modulePathLookups()) + "% resolved from the cache\n");
+        }
+        writeDirect(ColorStream::Color::None, "\n");
+        m_out.flush();
     }
 
-    inline std::wstring getTimestamp(const std::chrono::high_resolution_clock::duration &time)
+    EventMask subscribedEvents() const override
     {
-        std::wstringstream out;
-        out << std::chrono::duration_cast<std::chrono::hours>(time).count() << ":"
-            << std::chrono::duration_cast<std::chrono::minutes>(time).count() % 60 << ":"
-            << std::chrono::duration_cast<std::chrono::seconds>(time).count() % 60 << ":"
-            << std::chrono::duration_cast<std::chrono::milliseconds>(time).count() % 1000;
-        return out.str();
+        // the capture and the json lines always record the dlls
+        if (m_logDll || m_capture || m_jsonLines) {
+            return AllEvents;
+        }
+        return AllEvents & ~(eventBit(VSDEvent::Type::DllLoad) | eventBit(VSDEvent::Type::DllUnload));
     }
 
-    inline void writeStdout(const std::wstring &data) { m_out.setColor(ColorStream::Color::None) << data; }
-
-    inline void writeErr(const std::wstring &data) { m_out.setColor(ColorStream::Color::Red) << data; }
-
-    inline void writeDebug(const VSDChildProcess *process, const std::wstring &data)
+    void onEvents(const VSDEvent *events, size_t count) override
     {
-        m_out.setColor(ColorStream::Color::Green) << process->name() << L"(" << process->id() << L"): " << rtrim(data) << L"\n";
+        if (m_capture) {
+            m_capture->write(events, count);
+        }
+        if (m_jsonLines) {
+            m_jsonLines->write(events, count);
+        }
+        // with only structured output there is nothing to format
+        if (m_out.isEmpty() && !m_processLogs) {
+            return;
+        }
+        ColorStream::Record record;
+        for (const VSDEvent *event = events; event != events + count; ++event) {
+            // each event is formatted once and the record is shared by all streams
+            if (!format(*event, record)) {
+                continue;
+            }
+            m_out.write(record);
+            if (m_processLogs) {
+                m_processLogs->write(*event, record);
+            }
+        }
+        m_out.flush();
+        if (m_processLogs) {
+            m_processLogs->flush();
+        }
     }
 
-    void writeDllLoad(const VSDChildProcess *process, const std::wstring &data, bool loading)
+    // the events are delivered in batches to onEvents, only the errors of libvsd are written directly
+    inline void writeStdout(std::string_view data) { writeDirect(ColorStream::Color::None, data); }
+
+    inline void writeErr(std::string_view data) { writeDirect(ColorStream::Color::Red, data, true); }
+
+    inline void writeDebug(const VSDChildProcess *process, std::string_view data) { deliver(VSDEvent::Type::Debug, process, data); }
+
+    void writeDllLoad(const VSDChildProcess *process, std::string_view data, bool loading)
     {
-        if (m_logDll) {
-            m_out.setColor(ColorStream::Color::Green) << process->name() << L"(" << process->id() << L"): " << (loading ? L"Loading: " : L"Unloading: ") << data
-                                                      << L"\n";
-        }
+        deliver(loading ? VSDEvent::Type::DllLoad : VSDEvent::Type::DllUnload, process, data);
     }
 
-    inline void processStarted(const VSDChildProcess *process)
+    inline void processStarted(const VSDChildProcess *process) { deliver(VSDEvent::Type::ProcessStarted, process, {}); }
+
+    inline void processStopped(const VSDChildProcess *process) { deliver(VSDEvent::Type::ProcessStopped, process, {}); }
+
+    inline void stop()
     {
-        m_out.setColor(ColorStream::Color::Blue) << L"Process Created: " << process->path().wstring() << L" [" << process->arguments() << L"] ("
-                                                 << process->id() << L")\n";
+        m_process->stop();
     }
 
-    inline void processStopped(const VSDChildProcess *process)
+    int m_exitCode = 0;
+
+private:
+    // formats the event into m_line, returns false if the event is not logged
+    bool format(const VSDEvent &event, ColorStream::Record &record)
     {
-        m_out.setColor(ColorStream::Color::Blue) << L"Process Stopped: " << process->path().wstring() << L" (" << process->id() << L")";
-        if (!process->error().empty()) {
-            m_out << L" Error: "
-                  << process->error();
+        record.time = std::chrono::duration_cast<std::chrono::microseconds>(event.timestamp - m_startTime);
+        record.process = event.process ? std::string_view(event.process->utf8Name()) : std::string_view();
+        record.error = false;
+        m_line.clear();
+        switch (event.type) {
+        case VSDEvent::Type::Stdout:
+            record.color = ColorStream::Color::None;
+            record.text = event.data;
+            return true;
+        case VSDEvent::Type::Stderr:
+            record.color = ColorStream::Color::Red;
+            record.text = event.data;
+            record.error = true;
+            return true;
+        case VSDEvent::Type::Debug:
+            record.color = ColorStream::Color::Green;
+            formatDebug(m_line, event.process->prefix(), event.data);
+            break;
+        case VSDEvent::Type::DllLoad:
+        case VSDEvent::Type::DllUnload:
+            if (!m_logDll) {
+                return false;
+            }
+            record.color = ColorStream::Color::Green;
+            formatDllLoad(m_line, event.process->prefix(), event.data, event.type == VSDEvent::Type::DllLoad);
+            break;
+        case VSDEvent::Type::ProcessStarted:
+            record.color = ColorStream::Color::Blue;
+            formatProcessStarted(m_line, Utils::wideCharToMultiByte(event.process->path().wstring()), Utils::wideCharToMultiByte(event.process->arguments()),
+                                 event.pid);
+            break;
+        case VSDEvent::Type::ProcessStopped:
+            record.color = ColorStream::Color::Blue;
+            record.error = !event.process->error().empty();
+            formatProcessStopped(m_line, Utils::wideCharToMultiByte(event.process->path().wstring()), event.pid,
+                                 Utils::wideCharToMultiByte(event.process->error()), event.process->exitCode(), event.process->time());
+            break;
         }
-        std::wstringstream exitCode;
-        exitCode << std::hex << std::showbase << process->exitCode() << std::dec;
-        m_out << L" With exit Code: "
-              << exitCode.str()
-              << L" After: "
-              << getTimestamp(process->time())
-              << L"\n";
+        record.text = m_line;
+        return true;
     }
 
-    inline void stop()
+    // a single event that didn't come through the dispatcher
+    void deliver(VSDEvent::Type type, const VSDChildProcess *process, std::string_view data)
     {
-        m_process->stop();
+        const VSDEvent event { type, process->id(), 0, process, std::chrono::high_resolution_clock::now(), data };
+        onEvents(&event, 1);
     }
 
-    int m_exitCode = 0;
+    // the messages of vsd itself, they are not part of the capture or the structured logs
+    void writeDirect(ColorStream::Color color, std::string_view text, bool error = false)
+    {
+        ColorStream::Record record;
+        record.color = color;
+        record.text = text;
+        record.time = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now() - m_startTime);
+        record.error = error;
+        m_out.write(record);
+    }
 
-private:
     ColorGroupoStream m_out;
+    // reused for the formatting of each event
+    std::string m_line;
+    std::unique_ptr<Capture::Writer> m_capture;
+    std::unique_ptr<JsonLinesWriter> m_jsonLines;
+    std::unique_ptr<ProcessLogs> m_processLogs;
     VSDProcess *m_process;
     bool m_noOutput = false;
     bool m_logDll = false;
+    const std::chrono::high_resolution_clock::time_point m_startTime = std::chrono::high_resolution_clock::now();
     VSDProcess::ProcessChannelMode m_channels = VSDProcess::ProcessChannelMode::MergedChannels;
 };
 
 
+// vsd --render file.vsdc [OPTIONS]
+int renderCapture(wchar_t *in[], int len)
+{
+    if (len < 3) {
+        printHelp();
+    }
+    const std::filesystem::path captureFile(in[2]);
+    Capture::Reader reader(captureFile);
+    if (!reader.isValid()) {
+        std::wcerr << L"Failed to read capture " << captureFile.wstring() << std::endl;
+        return 1;
+    }
+
+    std::filesystem::path logFile;
+    bool htmlLog = true;
+    bool pagedLog = false;
+    uint64_t pageSize = readConfig().value("logPageKiB", uint64_t(4096)) * 1024;
+    bool logDll = false;
+    bool noOutput = false;
+    for (int i = 3; i < len; ++i) {
+        std::wstring arg(in[i]);
+        if (arg == L"--vsd-log" || arg == L"--vsd-log-plain" || arg == L"--vsd-log-paged") {
+            htmlLog = arg != L"--vsd-log-plain";
+            pagedLog = arg == L"--vsd-log-paged";
+            if (i + 1 < len) {
+                logFile = in[++i];
+            } else {
+                printHelp();
+            }
+        } else if (arg == L"--vsd-log-page-size") {
+            if (i + 1 < len) {
+                pageSize = std::wcstoull(in[++i], nullptr, 10) * 1024;
+            } else {
+                printHelp();
+            }
+        } else if (arg == L"--vsd-log-dll") {
+            logDll = true;
+        } else if (arg == L"--vsd-no-console") {
+            noOutput = true;
+        } else {
+            printHelp();
+        }
+    }
+
+    if (pageSize == 0) {
+        printHelp();
+    }
+
+    ColorGroupoStream out;
+    if (!noOutput) {
+        out.addStream(new ColorOutStream(GetStdHandle(STD_OUTPUT_HANDLE)));
+    }
+    if (!logFile.empty()) {
+        const LogWriter::FlushPolicy policy;
+        if (pagedLog) {
+            out.addStream(new PagedHtmlStream(logFile, LogWriter::Type::Async, policy, pageSize, Utils::multiByteToWideChar(reader.program()),
+                                              Utils::multiByteToWideChar(reader.arguments())));
+        } else if (htmlLog) {
+            out.addStream(new ColorFileStream(logFile, LogWriter::Type::Async, policy, {}, Utils::multiByteToWideChar(reader.program()), Utils::multiByteToWideChar(reader.arguments())));
+        } else {
+            out.addStream(new SimpleFileStream(logFile, LogWriter::Type::Async, policy, {}));
+        }
+    }
+    ColorStream::Record record;
+    const std::string header = std::string(reader.program()) + " " + std::string(reader.arguments()) + "\n";
+    record.color = ColorStream::Color::Blue;
+    record.text = header;
+    out.write(record);
+
+    // the ProcessStarted record of each running process and the prefix of its messages,
+    // the views stay valid as long as the reader exists
+    struct Process
+    {
+        Capture::Record started;
+        std::string prefix;
+    };
+    std::unordered_map<unsigned long, Process> processes;
+    Capture::Record event;
+    // reused for the formatting of each event
+    std::string line;
+    while (reader.next(event)) {
+        record.time = event.time;
+        record.error = false;
+        line.clear();
+        Process &process = processes[event.pid];
+        switch (event.type) {
+        case Capture::Type::Stdout:
+            record.color = ColorStream::Color::None;
+            record.text = event.data;
+            break;
+        case Capture::Type::Stderr:
+            record.color = ColorStream::Color::Red;
+            record.text = event.data;
+            record.error = true;
+            break;
+        case Capture::Type::Debug:
+            record.color = ColorStream::Color::Green;
+            formatDebug(line, process.prefix, event.data);
+            record.text = line;
+            break;
+        case Capture::Type::DllLoad:
+        case Capture::Type::DllUnload:
+            if (!logDll) {
+                continue;
+            }
+            record.color = ColorStream::Color::Green;
+            formatDllLoad(line, process.prefix, event.data, event.type == Capture::Type::DllLoad);
+            record.text = line;
+            break;
+        case Capture::Type::ProcessStarted:
+            process.started = event;
+            process.prefix = std::string(event.data) + "(" + std::to_string(event.pid) + "): ";
+            record.color = ColorStream::Color::Blue;
+            formatProcessStarted(line, event.path, event.arguments, event.pid);
+            record.text = line;
+            break;
+        case Capture::Type::ProcessStopped:
+            record.color = ColorStream::Color::Blue;
+            record.error = !event.data.empty();
+            formatProcessStopped(line, process.started.path, event.pid, event.data, event.exitCode, event.runTime);
+            record.text = line;
+            break;
+        }
+        // stdout and stderr have no process, so their entry stays empty
+        record.process = process.started.data;
+        out.write(record);
+        if (event.type == Capture::Type::ProcessStopped) {
+            processes.erase(event.pid);
+        }
+    }
+    record = ColorStream::Record();
+    record.text = "\n";
+    out.write(record);
+    out.flush();
+    return 0;
+}
+
 static VSDImp *vsdimp = nullptr;
 
 void sighandler(int sig)
@@ -449,6 +1243,9 @@ int main()
     if (argc < 2) {
         printHelp();
     }
+    if (std::wstring_view(argv[1]) == L"--render") {
+        return renderCapture(argv, argc);
+    }
 
     vsdimp = new VSDImp(argv, argc);
 
@@ -0,0 +1,108 @@
+/*
+    VSD prints debugging messages of applications and their
+    sub-processes to console and supports logging of their output.
+    Copyright (C) 2026  Hannah von Reth <vonreth@kde.org>
+
+
+    VSD is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    VSD is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with VSD.  If not, see <http://www.gnu.org/licenses/>.
+    */
+
+
+#include "mappedfilewriter.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+bool resize(HANDLE file, uint64_t size)
+{
+    LARGE_INTEGER pos;
+    pos.QuadPart = static_cast<LONGLONG>(size);
+    return SetFilePointerEx(file, pos, nullptr, FILE_BEGIN) && SetEndOfFile(file);
+}
+}
+
+MappedFileWriter::MappedFileWriter(const std::filesystem::path &path)
+    : m_file(CreateFileW(path.wstring().c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr))
+{
+    if (m_file != INVALID_HANDLE_VALUE && !map(0)) {
+        CloseHandle(m_file);
+        m_file = INVALID_HANDLE_VALUE;
+    }
+}
+
+MappedFileWriter::~MappedFileWriter()
+{
+    if (m_file == INVALID_HANDLE_VALUE) {
+        return;
+    }
+    unmap();
+    resize(m_file, m_length);
+    CloseHandle(m_file);
+}
+
+bool MappedFileWriter::isOpen() const
+{
+    return m_file != INVALID_HANDLE_VALUE;
+}
+
+void MappedFileWriter::write(std::string_view data)
+{
+    while (!data.empty() && m_window) {
+        const uint64_t windowPos = m_length - m_windowOffset;
+        if (windowPos == WindowSize) {
+            if (!map(m_windowOffset + WindowSize)) {
+                return;
+            }
+            continue;
+        }
+        const size_t size = static_cast<size_t>(std::min<uint64_t>(WindowSize - windowPos, data.size()));
+        memcpy(m_window + windowPos, data.data(), size);
+        m_length += size;
+        data.remove_prefix(size);
+    }
+}
+
+void MappedFileWriter::flush()
+{
+}
+
+bool MappedFileWriter::map(uint64_t offset)
+{
+    unmap();
+    if (offset + WindowSize > m_fileSize) {
+        const uint64_t size = (offset + WindowSize + ExtentSize - 1) / ExtentSize * ExtentSize;
+        if (!resize(m_file, size)) {
+            return false;
+        }
+        m_fileSize = size;
+    }
+    // the view keeps the mapping alive
+    HANDLE mapping = CreateFileMappingW(m_file, nullptr, PAGE_READWRITE, 0, 0, nullptr);
+    if (!mapping) {
+        return false;
+    }
+    m_window = static_cast<char *>(MapViewOfFile(mapping, FILE_MAP_WRITE, static_cast<DWORD>(offset >> 32), static_cast<DWORD>(offset), WindowSize));
+    CloseHandle(mapping);
+    m_windowOffset = offset;
+    return m_window != nullptr;
+}
+
+void MappedFileWriter::unmap()
+{
+    if (m_window) {
+        UnmapViewOfFile(m_window);
+        m_window = nullptr;
+    }
+}
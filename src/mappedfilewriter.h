@@ -0,0 +1,62 @@
+/*
+    VSD prints debugging messages of applications and their
+    sub-processes to console and supports logging of their output.
+    Copyright (C) 2026  Hannah von Reth <vonreth@kde.org>
+
+
+    VSD is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    VSD is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with VSD.  If not, see <http://www.gnu.org/licenses/>.
+    */
+
+
+#ifndef MAPPEDFILEWRITER_H
+#define MAPPEDFILEWRITER_H
+
+#include "logwriter.h"
+
+#include <cstdint>
+
+#include <windows.h>
+
+// Preallocates the file in large extents and appends by copying into a mapped window of it.
+// The written data is part of the file cache right away, so there is nothing to flush.
+// The file is truncated to the written length on close, until then it ends with the zeroed preallocation.
+class MappedFileWriter : public LogWriter
+{
+public:
+    MappedFileWriter(const std::filesystem::path &path);
+    ~MappedFileWriter() override;
+
+    bool isOpen() const override;
+    void write(std::string_view data) override;
+    void flush() override;
+
+private:
+    // the file grows by this size
+    static constexpr uint64_t ExtentSize = 64 * 1024 * 1024;
+    // a multiple of the allocation granularity of 64KiB
+    static constexpr uint64_t WindowSize = 16 * 1024 * 1024;
+
+    bool map(uint64_t offset);
+    void unmap();
+
+    HANDLE m_file;
+    uint64_t m_fileSize = 0;
+    // the offset of the window in the file
+    uint64_t m_windowOffset = 0;
+    char *m_window = nullptr;
+    // the length of the data written
+    uint64_t m_length = 0;
+};
+
+#endif // MAPPEDFILEWRITER_H
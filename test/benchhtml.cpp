@@ -0,0 +1,82 @@
+#include "libvsd/utils.h"
+
+#include <chrono>
+#include <codecvt>
+#include <iostream>
+#include <locale>
+#include <regex>
+#include <string>
+#include <vector>
+
+// compares the previous html log, which replaced the line breaks of the utf-16 messages with a std::wregex
+// and converted them to utf-8 in the file stream, with Utils::appendEscapedHtml on a set of typical log lines
+namespace {
+std::vector<std::string> makeLines()
+{
+    std::vector<std::string> lines;
+    for (int i = 0; i < 10000; ++i) {
+        std::string line = "[" + std::to_string(i) + "] ";
+        switch (i % 4) {
+        case 0:
+            line += "kf5.kio.core: KIO::SlaveInterface::dispatch - slave finished\r\n";
+            break;
+        case 1:
+            line += "qt.qpa.windows: QWindowsWindow::setGeometry: Unable to set geometry 1024x768+0+0\n";
+            break;
+        case 2:
+            line += "warning: template<class T> bool operator<(const T &a, const T &b) && x > 0\n";
+            break;
+        default:
+            line += "loaded C:\\Program Files\\KDE\\bin\\KF5CoreAddons.dll";
+        }
+        lines.push_back(std::move(line));
+    }
+    return lines;
+}
+
+// the lines are ascii, so the throughput in characters is the same for utf-8 and utf-16 input
+template<typename Line, typename F>
+void run(const char *name, const std::vector<Line> &lines, F f)
+{
+    constexpr int Rounds = 20;
+    size_t bytes = 0;
+    size_t written = 0;
+    const auto start = std::chrono::high_resolution_clock::now();
+    for (int r = 0; r < Rounds; ++r) {
+        for (const auto &line : lines) {
+            bytes += line.size();
+            written += f(line);
+        }
+    }
+    const std::chrono::duration<double> elapsed = std::chrono::high_resolution_clock::now() - start;
+    std::cout << name << ": " << (bytes / (1024.0 * 1024.0)) / elapsed.count() << " MiB/s ("
+              << written << " bytes written)" << std::endl;
+}
+}
+
+int main()
+{
+    const auto lines = makeLines();
+
+    // the messages used to arrive as utf-16
+    std::vector<std::wstring> wideLines;
+    for (const auto &line : lines) {
+        wideLines.push_back(Utils::multiByteToWideChar(line));
+    }
+#pragma warning(disable : 4996)
+    std::wstring_convert<std::codecvt_utf8_utf16<wchar_t>> converter;
+#pragma warning(default : 4996)
+    run("std::wregex and std::codecvt_utf8_utf16", wideLines, [&converter](const std::wstring &line) {
+        static std::wregex regex(L"[\\r|\\r\\n]");
+        return converter.to_bytes(std::regex_replace(line.data(), regex, L"</br>")).size();
+    });
+
+    std::string buffer;
+    run("Utils::appendEscapedHtml", lines, [&buffer](const std::string &line) {
+        Utils::appendEscapedHtml(line, buffer);
+        const size_t size = buffer.size();
+        buffer.clear();
+        return size;
+    });
+    return 0;
+}
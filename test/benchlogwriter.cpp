@@ -0,0 +1,68 @@
+#include "asyncfilewriter.h"
+#include "mappedfilewriter.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+// writes the same log lines through std::ofstream, the AsyncFileWriter and the MappedFileWriter
+// usage: benchlogwriter [MiB]
+namespace {
+std::vector<std::string> makeLines()
+{
+    std::vector<std::string> lines;
+    for (int i = 0; i < 1000; ++i) {
+        lines.push_back("kstars(9496): [" + std::to_string(i) + "] qt.qpa.windows: QWindowsWindow::setGeometry: Unable to set geometry "
+                        + std::string(i % 80, 'x') + "\n");
+    }
+    return lines;
+}
+
+template<typename F>
+void run(const char *name, const std::filesystem::path &path, const std::vector<std::string> &lines, size_t total, F open)
+{
+    size_t written = 0;
+    const auto start = std::chrono::high_resolution_clock::now();
+    {
+        auto write = open(path);
+        while (written < total) {
+            for (const auto &line : lines) {
+                write(line);
+                written += line.size();
+            }
+        }
+    }
+    const std::chrono::duration<double> elapsed = std::chrono::high_resolution_clock::now() - start;
+    std::cout << name << ": " << (written / (1024.0 * 1024.0)) / elapsed.count() << " MiB/s, file size "
+              << std::filesystem::file_size(path) << std::endl;
+    std::filesystem::remove(path);
+}
+}
+
+int main(int argc, char *argv[])
+{
+    const size_t total = (argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 1024) * 1024 * 1024;
+    const auto lines = makeLines();
+    const std::filesystem::path path = std::filesystem::temp_directory_path() / "benchlogwriter.log";
+
+    run("std::ofstream", path, lines, total, [](const std::filesystem::path &path) {
+        auto out = std::make_shared<std::ofstream>(path, std::ios::out | std::ios::binary);
+        return [out](const std::string &line) { *out << line; };
+    });
+
+    run("AsyncFileWriter", path, lines, total, [](const std::filesystem::path &path) {
+        auto out = std::make_shared<AsyncFileWriter>(path, LogWriter::FlushPolicy());
+        return [out](const std::string &line) { out->write(line); };
+    });
+
+    run("MappedFileWriter", path, lines, total, [](const std::filesystem::path &path) {
+        auto out = std::make_shared<MappedFileWriter>(path);
+        return [out](const std::string &line) { out->write(line); };
+    });
+    return 0;
+}
@@ -0,0 +1,25 @@
+#ifndef CHECK_H
+#define CHECK_H
+
+#include <iostream>
+
+// minimal assertions for the unit tests, main returns the number of failures
+namespace Check {
+inline int &failures()
+{
+    static int count = 0;
+    return count;
+}
+
+inline void check(bool condition, const char *expression, const char *file, int line)
+{
+    if (!condition) {
+        ++failures();
+        std::cerr << file << ":" << line << ": check failed: " << expression << std::endl;
+    }
+}
+}
+
+#define CHECK(expression) Check::check((expression), #expression, __FILE__, __LINE__)
+
+#endif // CHECK_H
@@ -0,0 +1,149 @@
+#include "check.h"
+
+#include "libvsd/vsdchildtable.h"
+
+#include <algorithm>
+#include <random>
+#include <unordered_map>
+#include <vector>
+
+using namespace libvsd;
+
+// tests the open addressing of VSDChildTable against std::unordered_map,
+// the table only stores the pointers, so fake ones are good enough
+namespace {
+VSDChildProcess *fakeChild(unsigned long id)
+{
+    return reinterpret_cast<VSDChildProcess *>(static_cast<uintptr_t>(id) * 16 + 16);
+}
+
+// the home slot in a table with the minimal capacity of 64 slots, like VSDChildTable::home
+size_t homeOf64(unsigned long id)
+{
+    return static_cast<size_t>((static_cast<uint64_t>(id) * 0x9E3779B97F4A7C15ull) >> 58);
+}
+
+bool matches(const VSDChildTable &table, const std::unordered_map<unsigned long, VSDChildProcess *> &reference)
+{
+    if (table.size() != reference.size() || table.empty() != reference.empty()) {
+        return false;
+    }
+    for (const auto &entry : reference) {
+        if (table.find(entry.first) != entry.second) {
+            return false;
+        }
+    }
+    size_t count = 0;
+    bool known = true;
+    table.forEach([&](VSDChildProcess *child) {
+        ++count;
+        known &= std::any_of(reference.begin(), reference.end(), [child](const auto &entry) { return entry.second == child; });
+    });
+    return known && count == reference.size();
+}
+
+void testBasics()
+{
+    VSDChildTable table;
+    CHECK(table.empty());
+    CHECK(table.find(4) == nullptr);
+    table.insert(4, fakeChild(4));
+    CHECK(table.size() == 1);
+    CHECK(table.find(4) == fakeChild(4));
+    // inserting a known id replaces the process, pids are reused
+    table.insert(4, fakeChild(5));
+    CHECK(table.size() == 1);
+    CHECK(table.find(4) == fakeChild(5));
+    table.erase(8);
+    CHECK(table.size() == 1);
+    table.erase(4);
+    CHECK(table.empty());
+    CHECK(table.find(4) == nullptr);
+    table.erase(4);
+    CHECK(table.empty());
+}
+
+void testWrapAround()
+{
+    // a cluster starting in the last slot continues at the front of the table
+    std::vector<unsigned long> ids;
+    for (unsigned long id = 4; ids.size() < 4; id += 4) {
+        if (homeOf64(id) == 63) {
+            ids.push_back(id);
+        }
+    }
+    // an entry at home in slot 0, it is displaced by the cluster
+    unsigned long front = 4;
+    while (homeOf64(front) != 0) {
+        front += 4;
+    }
+    VSDChildTable table;
+    std::unordered_map<unsigned long, VSDChildProcess *> reference;
+    for (const auto id : ids) {
+        table.insert(id, fakeChild(id));
+        reference[id] = fakeChild(id);
+    }
+    table.insert(front, fakeChild(front));
+    reference[front] = fakeChild(front);
+    CHECK(matches(table, reference));
+    // the backward shift has to move the wrapped entries back across the end of the table
+    for (const auto id : ids) {
+        table.erase(id);
+        reference.erase(id);
+        CHECK(matches(table, reference));
+    }
+    table.erase(front);
+    CHECK(table.empty());
+}
+
+void testResize()
+{
+    VSDChildTable table;
+    std::unordered_map<unsigned long, VSDChildProcess *> reference;
+    for (unsigned long id = 4; id <= 4 * 5000; id += 4) {
+        table.insert(id, fakeChild(id));
+        reference[id] = fakeChild(id);
+    }
+    CHECK(matches(table, reference));
+    for (unsigned long id = 4; id <= 4 * 5000; id += 8) {
+        table.erase(id);
+        reference.erase(id);
+    }
+    CHECK(matches(table, reference));
+    CHECK(table.find(4) == nullptr);
+    CHECK(table.find(8) == fakeChild(8));
+}
+
+void testRandom()
+{
+    // few distinct ids, so the same slots are filled and emptied over and over
+    std::mt19937 random(42);
+    VSDChildTable table;
+    std::unordered_map<unsigned long, VSDChildProcess *> reference;
+    for (int i = 0; i < 200000; ++i) {
+        const unsigned long id = (random() % 200 + 1) * 4;
+        if (random() % 2) {
+            const auto child = fakeChild(random() % 1000);
+            table.insert(id, child);
+            reference[id] = child;
+        } else {
+            table.erase(id);
+            reference.erase(id);
+        }
+        if (i % 1000 == 0) {
+            CHECK(matches(table, reference));
+        }
+        CHECK(table.find(id) == (reference.count(id) ? reference[id] : nullptr));
+    }
+    CHECK(matches(table, reference));
+}
+}
+
+int main()
+{
+    testBasics();
+    testWrapAround();
+    testResize();
+    testRandom();
+    return Check::failures();
+}
@@ -0,0 +1,162 @@
+#include "check.h"
+
+#include "libvsd/utils.h"
+
+#include <random>
+#include <string>
+#include <string_view>
+
+// tests the html and json escaping, the special characters are placed around the 16 byte blocks of the fast paths
+namespace {
+std::string html(std::string_view data)
+{
+    std::string out;
+    Utils::appendEscapedHtml(data, out);
+    return out;
+}
+
+std::string json(std::string_view data)
+{
+    std::string out;
+    Utils::appendEscapedJson(data, out);
+    return out;
+}
+
+std::string referenceHtml(std::string_view data)
+{
+    std::string out;
+    for (size_t i = 0; i < data.size(); ++i) {
+        switch (data[i]) {
+        case '&':
+            out += "&amp;";
+            break;
+        case '<':
+            out += "&lt;";
+            break;
+        case '>':
+            out += "&gt;";
+            break;
+        case '\r':
+            if (i + 1 < data.size() && data[i + 1] == '\n') {
+                ++i;
+            }
+            out += "<br>";
+            break;
+        case '\n':
+            out += "<br>";
+            break;
+        default:
+            out += data[i];
+        }
+    }
+    return out;
+}
+
+std::string referenceJson(std::string_view data)
+{
+    static const char hex[] = "0123456789abcdef";
+    std::string out;
+    for (const char c : data) {
+        switch (c) {
+        case '"':
+            out += "\\\"";
+            break;
+        case '\\':
+            out += "\\\\";
+            break;
+        case '\n':
+            out += "\\n";
+            break;
+        case '\r':
+            out += "\\r";
+            break;
+        case '\t':
+            out += "\\t";
+            break;
+        default:
+            if (static_cast<unsigned char>(c) < 0x20) {
+                out += "\\u00";
+                out += hex[c >> 4];
+                out += hex[c & 0xF];
+            } else {
+                out += c;
+            }
+        }
+    }
+    return out;
+}
+
+void testHtml()
+{
+    CHECK(html("") == "");
+    CHECK(html("plain text") == "plain text");
+    CHECK(html("a < b && c > d") == "a &lt; b &amp;&amp; c &gt; d");
+    CHECK(html("&amp;") == "&amp;amp;");
+    // quotes only need to be escaped in attributes
+    CHECK(html("\"quoted\" 'text'") == "\"quoted\" 'text'");
+    CHECK(html("a\nb\r\nc\rd\n\re") == "a<br>b<br>c<br>d<br><br>e");
+    CHECK(html("tab\tbell\a") == "tab\tbell\a");
+    CHECK(html("gr\xC3\xBC\xC3\x9F <\xE2\x82\xAC>") == "gr\xC3\xBC\xC3\x9F &lt;\xE2\x82\xAC&gt;");
+
+    // the output is appended
+    std::string out = "<p>";
+    Utils::appendEscapedHtml("a&b", out);
+    CHECK(out == "<p>a&amp;b");
+}
+
+void testJson()
+{
+    CHECK(json("") == "");
+    CHECK(json("plain text") == "plain text");
+    CHECK(json("say \"hi\"") == "say \\\"hi\\\"");
+    CHECK(json("C:\\Program Files") == "C:\\\\Program Files");
+    CHECK(json("a\nb\r\tc") == "a\\nb\\r\\tc");
+    CHECK(json(std::string_view("\0\x01\x1f\x7f", 4)) == "\\u0000\\u0001\\u001f\x7f");
+    // html characters and non ascii text are passed through
+    CHECK(json("<a href='x'>&</a>") == "<a href='x'>&</a>");
+    CHECK(json("gr\xC3\xBC\xC3\x9F \xF0\x9F\x92\xA9") == "gr\xC3\xBC\xC3\x9F \xF0\x9F\x92\xA9");
+}
+
+void testBlockBoundaries()
+{
+    // a special character at every position of the first blocks, followed by a second one in the same or the next block
+    const char specials[] = { '&', '<', '>', '\r', '\n', '"', '\\', '\t', '\x01', '\x1f', ' ', '\x80', '\xff' };
+    for (const char first : specials) {
+        for (const char second : specials) {
+            for (size_t pos = 0; pos < 40; ++pos) {
+                for (size_t distance : { 1, 2, 15, 16, 17 }) {
+                    std::string data(pos + distance + 20, 'x');
+                    data[pos] = first;
+                    data[pos + distance] = second;
+                    CHECK(html(data) == referenceHtml(data));
+                    CHECK(json(data) == referenceJson(data));
+                }
+            }
+        }
+    }
+}
+
+void testRandom()
+{
+    // mostly text with a few special characters
+    std::mt19937 random(42);
+    const std::string alphabet = "&<>\r\n\"\\\t\x01\x1f\x7f\xC3\xBC";
+    for (int i = 0; i < 5000; ++i) {
+        std::string data(random() % 100, ' ');
+        for (auto &c : data) {
+            c = random() % 8 ? static_cast<char>('a' + random() % 26) : alphabet[random() % alphabet.size()];
+        }
+        CHECK(html(data) == referenceHtml(data));
+        CHECK(json(data) == referenceJson(data));
+    }
+}
+}
+
+int main()
+{
+    testHtml();
+    testJson();
+    testBlockBoundaries();
+    testRandom();
+    return Check::failures();
+}
@@ -0,0 +1,131 @@
+#include "check.h"
+
+#include "libvsd/vsdlineframer.h"
+
+#include <string>
+#include <vector>
+
+// tests the line splitting of the pipe reader with lines spanning several reads
+namespace {
+struct Collector
+{
+    std::vector<std::string> lines;
+
+    void operator()(std::string_view line)
+    {
+        lines.emplace_back(line);
+    }
+};
+
+std::vector<std::string> feedAll(VSDLineFramer &framer, const std::vector<std::string> &chunks)
+{
+    Collector collector;
+    for (const auto &chunk : chunks) {
+        framer.feed(chunk, collector);
+    }
+    return collector.lines;
+}
+
+void testLines()
+{
+    VSDLineFramer framer(1024);
+    CHECK(feedAll(framer, { "first\nsecond\r\nthird" }) == std::vector<std::string>({ "first\n", "second\r\n" }));
+    CHECK(framer.hasPartialLine());
+    // the partial line is completed by the next read
+    CHECK(feedAll(framer, { " line\n" }) == std::vector<std::string>({ "third line\n" }));
+    CHECK(!framer.hasPartialLine());
+    CHECK(feedAll(framer, { "" }).empty());
+    CHECK(feedAll(framer, { "\n\n" }) == std::vector<std::string>({ "\n", "\n" }));
+}
+
+void testCrlfSplit()
+{
+    VSDLineFramer framer(1024);
+    CHECK(feedAll(framer, { "line\r", "\nnext\r", "\n" }) == std::vector<std::string>({ "line\r\n", "next\r\n" }));
+    CHECK(!framer.hasPartialLine());
+    // a line spanning many reads
+    CHECK(feedAll(framer, { "a", "b", "c", "\r", "\n" }) == std::vector<std::string>({ "abc\r\n" }));
+}
+
+void testUtf8Split()
+{
+    // € is E2 82 AC, split after every byte at the chunk boundary
+    for (size_t split = 1; split < 3; ++split) {
+        const std::string euro = "\xE2\x82\xAC";
+        VSDLineFramer framer(1024);
+        CHECK(feedAll(framer, { "price " + euro.substr(0, split), euro.substr(split) + "\n" })
+              == std::vector<std::string>({ "price " + euro + "\n" }));
+    }
+    // a flush never splits a sequence, the rest stays for the next read
+    VSDLineFramer framer(1024);
+    Collector collector;
+    framer.feed("price \xF0\x9F\x92", collector);
+    framer.flush(collector);
+    CHECK(collector.lines == std::vector<std::string>({ "price " }));
+    CHECK(framer.hasPartialLine());
+    framer.feed("\xA9\n", collector);
+    CHECK(collector.lines == std::vector<std::string>({ "price ", "\xF0\x9F\x92\xA9\n" }));
+}
+
+void testFlush()
+{
+    // a partial line is emitted when the reader times out
+    VSDLineFramer framer(1024);
+    Collector collector;
+    framer.feed("progress: 50%", collector);
+    CHECK(collector.lines.empty());
+    framer.flush(collector);
+    CHECK(collector.lines == std::vector<std::string>({ "progress: 50%" }));
+    CHECK(!framer.hasPartialLine());
+    framer.flush(collector);
+    CHECK(collector.lines.size() == 1);
+    framer.feed(" done\n", collector);
+    CHECK(collector.lines.back() == " done\n");
+}
+
+void testLongLine()
+{
+    // lines without a break are flushed once they reach the maximal length
+    VSDLineFramer framer(8);
+    CHECK(feedAll(framer, { "0123", "456789", "ab\n" }) == std::vector<std::string>({ "0123456789", "ab\n" }));
+    // but not in the middle of a utf-8 sequence
+    CHECK(feedAll(framer, { "012345\xE2\x82", "\xAC\n" }) == std::vector<std::string>({ "012345", "\xE2\x82\xAC\n" }));
+}
+
+void testFinish()
+{
+    VSDLineFramer framer(1024);
+    Collector collector;
+    framer.finish(collector);
+    CHECK(collector.lines.empty());
+    // everything is emitted at the end of the stream, even an incomplete sequence
+    framer.feed("last\nno break \xE2\x82", collector);
+    framer.finish(collector);
+    CHECK(collector.lines == std::vector<std::string>({ "last\n", "no break \xE2\x82" }));
+    CHECK(!framer.hasPartialLine());
+}
+
+void testCompleteUtf8Length()
+{
+    CHECK(VSDLineFramer::completeUtf8Length("") == 0);
+    CHECK(VSDLineFramer::completeUtf8Length("abc") == 3);
+    CHECK(VSDLineFramer::completeUtf8Length("a\xC3") == 1);
+    CHECK(VSDLineFramer::completeUtf8Length("a\xC3\xBC") == 3);
+    CHECK(VSDLineFramer::completeUtf8Length("a\xF0\x9F\x92") == 1);
+    CHECK(VSDLineFramer::completeUtf8Length("a\xF0\x9F\x92\xA9") == 5);
+    // invalid data is passed on as it is
+    CHECK(VSDLineFramer::completeUtf8Length("\x80\x80") == 2);
+}
+}
+
+int main()
+{
+    testLines();
+    testCrlfSplit();
+    testUtf8Split();
+    testFlush();
+    testLongLine();
+    testFinish();
+    testCompleteUtf8Length();
+    return Check::failures();
+}
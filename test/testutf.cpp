@@ -0,0 +1,212 @@
+#include "check.h"
+
+#include "libvsd/utils.h"
+
+#include <algorithm>
+#include <random>
+#include <string>
+#include <string_view>
+
+// tests the sse2 transcoders against a plain reference implementation,
+// with special care for the 16 byte blocks of the fast paths and their tails
+namespace {
+// char16_t literals work with any wchar_t, the tests don't depend on the width of L""
+std::wstring wide(std::u16string_view data)
+{
+    return std::wstring(data.begin(), data.end());
+}
+
+bool equal(const std::wstring &a, const std::wstring &b)
+{
+    return a.size() == b.size() && std::equal(a.begin(), a.end(), b.begin());
+}
+
+std::string referenceUtf16ToUtf8(const std::wstring &data)
+{
+    std::string out;
+    for (size_t i = 0; i < data.size(); ++i) {
+        uint32_t c = static_cast<uint16_t>(data[i]);
+        if (c >= 0xD800 && c <= 0xDFFF) {
+            const uint32_t low = i + 1 < data.size() ? static_cast<uint16_t>(data[i + 1]) : 0;
+            if (c <= 0xDBFF && low >= 0xDC00 && low <= 0xDFFF) {
+                c = 0x10000 + ((c - 0xD800) << 10) + (low - 0xDC00);
+                ++i;
+            } else {
+                c = 0xFFFD;
+            }
+        }
+        if (c < 0x80) {
+            out += static_cast<char>(c);
+        } else if (c < 0x800) {
+            out += static_cast<char>(0xC0 | (c >> 6));
+            out += static_cast<char>(0x80 | (c & 0x3F));
+        } else if (c < 0x10000) {
+            out += static_cast<char>(0xE0 | (c >> 12));
+            out += static_cast<char>(0x80 | ((c >> 6) & 0x3F));
+            out += static_cast<char>(0x80 | (c & 0x3F));
+        } else {
+            out += static_cast<char>(0xF0 | (c >> 18));
+            out += static_cast<char>(0x80 | ((c >> 12) & 0x3F));
+            out += static_cast<char>(0x80 | ((c >> 6) & 0x3F));
+            out += static_cast<char>(0x80 | (c & 0x3F));
+        }
+    }
+    return out;
+}
+
+std::string toUtf8(const std::wstring &data)
+{
+    std::string out;
+    Utils::utf16ToUtf8(data, out);
+    return out;
+}
+
+std::wstring toUtf16(std::string_view data)
+{
+    std::wstring out;
+    Utils::utf8ToUtf16(data, out);
+    return out;
+}
+
+void testAsciiRuns()
+{
+    // every length around the block size at every alignment
+    const std::string text(80, 'a');
+    std::string buffer = "0123456789abcdef" + text;
+    for (size_t offset = 0; offset < 16; ++offset) {
+        for (size_t length = 0; length <= 64; ++length) {
+            const std::string_view ascii(buffer.data() + offset, length);
+            const std::wstring utf16 = toUtf16(ascii);
+            CHECK(utf16.size() == length);
+            CHECK(std::equal(ascii.begin(), ascii.end(), utf16.begin(), [](char a, wchar_t b) { return static_cast<wchar_t>(a) == b; }));
+            CHECK(toUtf8(utf16) == ascii);
+            CHECK(Utils::isAscii(ascii));
+            CHECK(Utils::isValidUtf8(ascii));
+        }
+    }
+}
+
+void testBlockBoundaries()
+{
+    // a multi byte sequence at every position of the first blocks, including sequences split by a block boundary
+    const std::string sequences[] = { "\xC3\xA9", "\xE2\x82\xAC", "\xF0\x9F\x92\xA9" };
+    const std::u16string expected[] = { u"é", u"€", u"\U0001F4A9" };
+    for (size_t s = 0; s < 3; ++s) {
+        for (size_t pos = 0; pos <= 40; ++pos) {
+            const std::string utf8 = std::string(pos, 'x') + sequences[s] + std::string(20, 'y');
+            const std::wstring utf16 = wide(std::u16string(pos, u'x') + expected[s] + std::u16string(20, u'y'));
+            CHECK(equal(toUtf16(utf8), utf16));
+            CHECK(toUtf8(utf16) == utf8);
+            CHECK(!Utils::isAscii(utf8));
+            CHECK(Utils::isValidUtf8(utf8));
+        }
+    }
+}
+
+void testSurrogates()
+{
+    const std::string pileOfPoo = "\xF0\x9F\x92\xA9";
+    const std::string replacement = "\xEF\xBF\xBD";
+    CHECK(toUtf8(wide(u"\U0001F4A9")) == pileOfPoo);
+    CHECK(equal(toUtf16(pileOfPoo), wide(u"\U0001F4A9")));
+    // a pair split by the 8 code unit blocks of the fast path
+    CHECK(toUtf8(wide(u"abcdefg\U0001F4A9hijklmnop")) == "abcdefg" + pileOfPoo + "hijklmnop");
+
+    // lone surrogates become U+FFFD
+    const std::u16string high(1, static_cast<char16_t>(0xD83D));
+    const std::u16string low(1, static_cast<char16_t>(0xDCA9));
+    CHECK(toUtf8(wide(high)) == replacement);
+    CHECK(toUtf8(wide(low)) == replacement);
+    CHECK(toUtf8(wide(u"abcdefgh" + high)) == "abcdefgh" + replacement);
+    CHECK(toUtf8(wide(high + u"a")) == replacement + "a");
+    CHECK(toUtf8(wide(low + high)) == replacement + replacement);
+    CHECK(toUtf8(wide(high + high + low)) == replacement + pileOfPoo);
+
+    // utf-8 encoded surrogates are invalid
+    CHECK(!Utils::isValidUtf8("\xED\xA0\xBD"));
+}
+
+void testInvalidUtf8()
+{
+    const std::string invalid[] = {
+        "\x80", // continuation byte without a lead byte
+        "\xC0\xAF", // overlong '/'
+        "\xE0\x80\xAF", // overlong '/'
+        "\xE2\x82", // truncated
+        "\xF4\x90\x80\x80", // above U+10FFFF
+        "\xF8\x88\x80\x80\x80", // 5 byte sequence
+        "\xFF",
+        "\xC3\x28", // missing continuation
+    };
+    for (const auto &sequence : invalid) {
+        for (size_t pos : { 0, 7, 15, 16, 17 }) {
+            const std::string data = std::string(pos, 'a') + sequence + "bc";
+            CHECK(!Utils::isValidUtf8(data));
+            // each invalid byte is replaced, the valid text around it is kept
+            const std::wstring utf16 = toUtf16(data);
+            CHECK(utf16.size() >= pos + 3);
+            CHECK(std::all_of(utf16.begin(), utf16.begin() + pos, [](wchar_t c) { return c == 'a'; }));
+            CHECK(utf16[pos] == 0xFFFD);
+            CHECK(utf16[utf16.size() - 2] == 'b' && utf16.back() == 'c');
+        }
+    }
+    CHECK(equal(toUtf16("\xC0\xAF"), wide(u"\uFFFD\uFFFD")));
+}
+
+void testRandom()
+{
+    // random utf-16 with ascii runs, bmp characters and valid and broken surrogates
+    std::mt19937 random(42);
+    for (int i = 0; i < 2000; ++i) {
+        std::wstring data;
+        const size_t length = random() % 100;
+        for (size_t j = 0; j < length; ++j) {
+            switch (random() % 6) {
+            case 0:
+                data += static_cast<wchar_t>(0x80 + random() % 0xD780);
+                break;
+            case 1:
+                data += static_cast<wchar_t>(0xD800 + random() % 0x800);
+                break;
+            case 2:
+                data += static_cast<wchar_t>(0xD800 + random() % 0x400);
+                data += static_cast<wchar_t>(0xDC00 + random() % 0x400);
+                break;
+            default:
+                data += static_cast<wchar_t>(0x20 + random() % 0x5F);
+            }
+        }
+        const std::string utf8 = toUtf8(data);
+        CHECK(utf8 == referenceUtf16ToUtf8(data));
+        CHECK(Utils::isValidUtf8(utf8));
+        // the round trip only differs in the replaced lone surrogates
+        CHECK(toUtf8(toUtf16(utf8)) == utf8);
+    }
+}
+
+void testAnsi()
+{
+    std::string out;
+    Utils::ansiToUtf8("plain ascii is passed through", out);
+    CHECK(out == "plain ascii is passed through");
+    // the code page depends on the system, but the result is always valid utf-8
+    std::string ansi;
+    for (int c = 1; c < 256; ++c) {
+        ansi += static_cast<char>(c);
+    }
+    Utils::ansiToUtf8(ansi, out);
+    CHECK(Utils::isValidUtf8(out));
+    CHECK(out.compare(0, 0x7F, ansi, 0, 0x7F) == 0);
+}
+}
+
+int main()
+{
+    testAsciiRuns();
+    testBlockBoundaries();
+    testSurrogates();
+    testInvalidUtf8();
+    testRandom();
+    testAnsi();
+    return Check::failures();
+}